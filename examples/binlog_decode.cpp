@@ -0,0 +1,72 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/BinaryLog.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace terminal;
+
+// Decodes a binary log file, as written by contour with "logging.format: binary",
+// into the same human readable text format as the text logger would have written.
+int main(int argc, char const* argv[])
+{
+    if (argc != 2)
+    {
+        cerr << "Usage: " << argv[0] << " LOGFILE" << endl;
+        return EXIT_FAILURE;
+    }
+
+    auto input = ifstream{argv[1], ios::binary};
+    if (!input.good())
+    {
+        cerr << "Could not open file. " << argv[1] << endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto reader = BinaryLogReader{input};
+        while (auto const entry = reader.next())
+        {
+            auto const ns = chrono::duration_cast<chrono::nanoseconds>(entry->timestamp.time_since_epoch()).count();
+            auto const timestamp = fmt::format("{}.{:09}", ns / 1'000'000'000, ns % 1'000'000'000);
+
+            if (entry->event.has_value())
+                cout << fmt::format("{} {}\n", timestamp, *entry->event);
+            else if (entry->commands.has_value())
+            {
+                // Formatted here rather than by the terminal, as the text logger would have done.
+                auto const& commands = *entry->commands;
+                cout << fmt::format("{} {}\n", timestamp,
+                                    LogEvent{TraceOutputEvent{fmt::format("onScreenUpdate: {} instructions", commands.size())}});
+                for (auto const& mnemonic : to_mnemonic(commands, true, true))
+                    cout << fmt::format("{} {}\n", timestamp, LogEvent{TraceOutputEvent{mnemonic}});
+            }
+            else
+                cout << fmt::format("{} ({} events dropped)\n", timestamp, entry->droppedCount);
+        }
+    }
+    catch (exception const& e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/FontManager.h>
+#include <glterminal/SoftwareRenderer.h>
+
+#include <terminal/Color.h>
+#include <terminal/Recording.h>
+#include <terminal/Screen.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace terminal;
+
+// Replays a session recording (see terminal_replay) into a headless screen and renders it with the
+// software renderer, without requiring OpenGL. The resulting image is written as PNG, or as PPM if the
+// output file name ends with ".ppm", e.g. for comparing against golden images.
+//
+// The screen is rendered after every chunk of the recording, as a frontend would,
+// reporting the time spent rendering along with the number of cells that had to be redrawn.
+int main(int argc, char const* argv[])
+{
+    if (argc != 5)
+    {
+        cerr << "Usage: " << argv[0] << " FONT FONT_SIZE RECORDING OUTPUT\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto input = ifstream{argv[3], ios::binary};
+        if (!input.good())
+        {
+            cerr << "Could not open file. " << argv[3] << endl;
+            return EXIT_FAILURE;
+        }
+
+        auto fontManager = FontManager{};
+        Font& font = fontManager.load(argv[1], static_cast<unsigned>(stoul(argv[2])));
+        auto const colorProfile = ColorProfile{};
+        auto renderer = SoftwareRenderer{font, colorProfile};
+
+        auto reader = RecordingReader{input};
+        auto screen = Screen{reader.size()};
+
+        auto busy = chrono::nanoseconds::zero();
+        size_t frames = 0;
+        size_t cellsRedrawn = 0;
+        while (auto const chunk = reader.next())
+        {
+            screen.write(chunk->data.data(), chunk->data.size());
+
+            auto const start = chrono::steady_clock::now();
+            cellsRedrawn += renderer.render(screen);
+            busy += chrono::steady_clock::now() - start;
+            ++frames;
+        }
+
+        auto const fileName = string{argv[4]};
+        auto output = ofstream{fileName, ios::binary | ios::trunc};
+        if (fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".ppm") == 0)
+            renderer.writePPM(output);
+        else
+            renderer.writePNG(output);
+
+        if (!output.good())
+        {
+            cerr << "Could not write file. " << fileName << endl;
+            return EXIT_FAILURE;
+        }
+
+        cout << fmt::format(
+            "{{\"frames\": {}, \"cellsRedrawn\": {}, \"renderSeconds\": {:.6f}, \"width\": {}, \"height\": {}}}\n",
+            frames, cellsRedrawn, chrono::duration<double>(busy).count(), renderer.width(), renderer.height()
+        );
+    }
+    catch (exception const& e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "BufferAge.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// Kept apart from other sources, as X11 headers define names such as Window in the global namespace.
+#if defined(CONTOUR_GLX)
+#define GLFW_EXPOSE_NATIVE_X11
+#define GLFW_EXPOSE_NATIVE_GLX
+#include <GLFW/glfw3native.h>
+
+#include <cstring>
+
+#if !defined(GLX_BACK_BUFFER_AGE_EXT)
+#define GLX_BACK_BUFFER_AGE_EXT 0x20F4
+#endif
+#endif
+
+bool bufferAgeSupported([[maybe_unused]] GLFWwindow* _window)
+{
+#if defined(CONTOUR_GLX)
+    // Both return nothing unless GLFW runs on X11 with a GLX context.
+    Display* display = glfwGetX11Display();
+    if (!display || glfwGetGLXWindow(_window) == None)
+        return false;
+
+    char const* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+    return extensions && std::strstr(extensions, "GLX_EXT_buffer_age") != nullptr;
+#else
+    return false;
+#endif
+}
+
+unsigned queryBufferAge([[maybe_unused]] GLFWwindow* _window)
+{
+#if defined(CONTOUR_GLX)
+    unsigned age = 0;
+    glXQueryDrawable(glfwGetX11Display(), glfwGetGLXWindow(_window), GLX_BACK_BUFFER_AGE_EXT, &age);
+    return age;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,24 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+struct GLFWwindow;
+
+/// @returns whether the age of the given window's back buffer can be queried,
+///          as is the case for GLX windows supporting GLX_EXT_buffer_age.
+bool bufferAgeSupported(GLFWwindow* _window);
+
+/// @returns the number of frames since the given window's back buffer was presented,
+///          or 0 if its contents are undefined or unknown.
+unsigned queryBufferAge(GLFWwindow* _window);
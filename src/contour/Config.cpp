@@ -21,6 +21,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -30,6 +31,7 @@ optional<int> loadConfigFromCLI(Config& _config, int _argc, char const* _argv[])
     flags.defineBool("help", 'h', "Shows this help and quits.");
     flags.defineBool("version", 'v', "Shows this version and exits.");
     flags.defineString("config", 'c', "PATH", "Specifies path to config file to load from (and save to).", "contour.yml");
+    flags.defineBool("timeline", 't', "Prints when each phase of startup was reached.");
 
     flags.parse(_argc, _argv);
     if (flags.getBool("help"))
@@ -52,6 +54,8 @@ optional<int> loadConfigFromCLI(Config& _config, int _argc, char const* _argv[])
     if (flags.isSet("config"))
         loadConfigFromFile(_config, flags.getString("config"));
 
+    _config.startupTimeline = flags.getBool("timeline");
+
     return nullopt;
 }
 
@@ -80,6 +84,9 @@ void loadConfigFromFile(Config& _config, std::string const& _fileName)
     softLoadValue(doc, "fontFamily", _config.fontFamily);
     softLoadValue(doc, "tabWidth", _config.tabWidth);
 
+    if (auto timeout = doc["alternateScreenTimeout"]; timeout)
+        _config.alternateScreenTimeout = chrono::seconds{timeout.as<unsigned>()};
+
     if (auto background = doc["background"]; background)
     {
         if (auto opacity = background["opacity"]; opacity)
@@ -154,6 +161,16 @@ void loadConfigFromFile(Config& _config, std::string const& _fileName)
         if (auto filePath = logging["file"]; filePath)
             _config.logFilePath = {filesystem::path{filePath.as<string>()}};
 
+        if (auto format = logging["format"]; format)
+        {
+            if (format.as<string>() == "binary")
+                _config.logFormat = LogFormat::Binary;
+            else if (format.as<string>() == "text")
+                _config.logFormat = LogFormat::Text;
+            else
+                throw runtime_error{"Invalid logging format. " + format.as<string>()};
+        }
+
         auto constexpr mappings = array{
             pair{"parseErrors", LogMask::ParserError},
             pair{"invalidOutput", LogMask::InvalidOutput},
@@ -175,6 +192,18 @@ void loadConfigFromFile(Config& _config, std::string const& _fileName)
             }
         }
     }
+
+    if (auto cacheDirectory = doc["cacheDirectory"]; cacheDirectory)
+        _config.cacheDirectory = {filesystem::path{cacheDirectory.as<string>()}};
+
+    if (auto tracing = doc["tracing"]; tracing)
+    {
+        if (auto enabled = tracing["enabled"]; enabled)
+            _config.tracingEnabled = enabled.as<bool>();
+
+        if (auto filePath = tracing["file"]; filePath)
+            _config.traceFilePath = filesystem::path{filePath.as<string>()};
+    }
 }
 
 std::string serializeYaml(Config const& _config)
@@ -186,6 +215,7 @@ std::string serializeYaml(Config const& _config)
     root["fontSize"] = _config.fontSize;
     root["fontFamily"] = _config.fontFamily;
     root["tabWidth"] = _config.tabWidth;
+    root["alternateScreenTimeout"] = static_cast<unsigned>(_config.alternateScreenTimeout.count());
     root["background"]["opacity"] = static_cast<float>(_config.backgroundOpacity) / 255.0f;
     root["background"]["blur"] = _config.backgroundBlur;
 
@@ -194,6 +224,7 @@ std::string serializeYaml(Config const& _config)
     root["cursor"]["shape"] = to_string(_config.cursorShape);
     root["cursor"]["blinking"] = _config.cursorBlinking;
 
+    root["logging"]["format"] = _config.logFormat == LogFormat::Binary ? "binary" : "text";
     root["logging"]["parseErrors"] = (_config.loggingMask & LogMask::ParserError) != 0;
     root["logging"]["invalidOutput"] = (_config.loggingMask & LogMask::InvalidOutput) != 0;
     root["logging"]["unsupportedOutput"] = (_config.loggingMask & LogMask::UnsupportedOutput) != 0;
@@ -202,6 +233,12 @@ std::string serializeYaml(Config const& _config)
     root["logging"]["traceInput"] = (_config.loggingMask & LogMask::TraceInput) != 0;
     root["logging"]["traceOutput"] = (_config.loggingMask & LogMask::TraceOutput) != 0;
 
+    if (_config.cacheDirectory)
+        root["cacheDirectory"] = _config.cacheDirectory->string();
+
+    root["tracing"]["enabled"] = _config.tracingEnabled;
+    root["tracing"]["file"] = _config.traceFilePath.string();
+
     ostringstream os;
     os << root;// TODO: returns LF? if not, endl it.
     return os.str();
@@ -212,3 +249,28 @@ void saveConfigToFile(Config const& _config, std::string const& _fileName)
     auto ofs = ofstream{_fileName, ios::trunc};
     ofs << serializeYaml(_config);
 }
+
+ConfigChange diff(Config const& _old, Config const& _new)
+{
+    auto changes = ConfigChange::None;
+    auto const compare = [&](auto const& _a, auto const& _b, ConfigChange _change) {
+        if (_a != _b)
+            changes |= _change;
+    };
+
+    compare(_old.logFilePath, _new.logFilePath, ConfigChange::Logging);
+    compare(_old.loggingMask, _new.loggingMask, ConfigChange::Logging);
+    compare(_old.logFormat, _new.logFormat, ConfigChange::Logging);
+    compare(_old.tabWidth, _new.tabWidth, ConfigChange::TabWidth);
+    compare(_old.fontFamily, _new.fontFamily, ConfigChange::FontFamily);
+    compare(_old.fontSize, _new.fontSize, ConfigChange::FontSize);
+    compare(_old.terminalSize, _new.terminalSize, ConfigChange::TerminalSize);
+    compare(_old.colorProfile, _new.colorProfile, ConfigChange::ColorProfile);
+    compare(_old.backgroundOpacity, _new.backgroundOpacity, ConfigChange::BackgroundOpacity);
+    compare(_old.cursorShape, _new.cursorShape, ConfigChange::CursorShape);
+    compare(_old.cursorBlinking, _new.cursorBlinking, ConfigChange::CursorBlinking);
+    compare(_old.tracingEnabled, _new.tracingEnabled, ConfigChange::Tracing);
+    compare(_old.alternateScreenTimeout, _new.alternateScreenTimeout, ConfigChange::AlternateScreen);
+
+    return changes;
+}
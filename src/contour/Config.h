@@ -18,6 +18,7 @@
 #include <terminal/Color.h>
 #include <terminal/WindowSize.h>
 #include <terminal/Process.h>
+#include <chrono>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -34,14 +35,65 @@ struct Config {
     CursorShape cursorShape = CursorShape::Block;
     bool cursorBlinking = true;
     unsigned int tabWidth = 8;
+    std::chrono::seconds alternateScreenTimeout{30}; // releases the alternate screen buffer when unused for that long
     terminal::Opacity backgroundOpacity = terminal::Opacity::Opaque; // value between 0 (fully transparent) and 0xFF (fully visible).
     bool backgroundBlur = false; // On Windows 10, this will enable Acrylic Backdrop.
     LogMask loggingMask;
+    LogFormat logFormat = LogFormat::Text;
+
+    /// Directory to cache compiled shader programs and prerasterized glyphs in, speeding up startup.
+    std::optional<std::filesystem::path> cacheDirectory;
+
+    bool startupTimeline = false; // prints when each phase of startup was reached
+
+    bool tracingEnabled = false;
+    std::filesystem::path traceFilePath = "contour-trace.json";
 
     terminal::ColorProfile colorProfile;
     // TODO: std::vector<KeyMapping>
 };
 
+/// Settings differing between two configurations, as far as they are applied at runtime.
+enum class ConfigChange {
+    None                = 0,
+
+    Logging             = 0x0001, // logFilePath, loggingMask, logFormat
+    TabWidth            = 0x0002,
+    FontFamily          = 0x0004,
+    FontSize            = 0x0008,
+    TerminalSize        = 0x0010,
+    ColorProfile        = 0x0020,
+    BackgroundOpacity   = 0x0040,
+    CursorShape         = 0x0080,
+    CursorBlinking      = 0x0100,
+    Tracing             = 0x0200, // tracingEnabled
+    AlternateScreen     = 0x0400, // alternateScreenTimeout
+};
+
+constexpr ConfigChange operator&(ConfigChange lhs, ConfigChange rhs) noexcept
+{
+    return static_cast<ConfigChange>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+}
+
+constexpr ConfigChange operator|(ConfigChange lhs, ConfigChange rhs) noexcept
+{
+    return static_cast<ConfigChange>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+}
+
+constexpr ConfigChange& operator|=(ConfigChange& lhs, ConfigChange rhs) noexcept
+{
+    lhs = lhs | rhs;
+    return lhs;
+}
+
+constexpr bool contains(ConfigChange _changes, ConfigChange _change) noexcept
+{
+    return (_changes & _change) != ConfigChange::None;
+}
+
+/// Compares two configurations field by field.
+ConfigChange diff(Config const& _old, Config const& _new);
+
 std::optional<int> loadConfigFromCLI(Config& _config, int argc, char const* argv[]);
 void loadConfigFromFile(Config& _config, std::string const& _fileName);
 
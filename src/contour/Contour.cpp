@@ -13,7 +13,11 @@
  */
 #include "Contour.h"
 #include <terminal/Color.h>
+#include <terminal/IdleTimeout.h>
+#include <terminal/Tracer.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <cstdio>
@@ -30,13 +34,31 @@
 using namespace std;
 using namespace std::placeholders;
 
-Contour::Contour(Config const& _config) :
+namespace {
+    auto const envvars = terminal::Process::Environment{
+        {"TERM", "xterm-256color"},
+        {"COLORTERM", "xterm"},
+        {"COLORFGBG", "15;0"},
+        {"LINES", ""},
+        {"COLUMNS", ""},
+        {"TERMCAP", ""}
+    };
+}
+
+Contour::Contour(Config const& _config, chrono::steady_clock::time_point _startTime) :
     config_{_config},
     logger_{
         _config.logFilePath
-            ? GLLogger{_config.loggingMask, _config.logFilePath->string()}
+            ? GLLogger{_config.loggingMask, _config.logFormat, _config.logFilePath->string()}
             : GLLogger{_config.loggingMask, &cout}
     },
+    timeline_{ _startTime },
+    terminal_{
+        config_.terminalSize,
+        [this](terminal::LogEvent const& _event) { logger_(_event); },
+        bind(&Contour::onScreenCommands, this, _1)
+    },
+    process_{ terminal_, config_.shell, {config_.shell}, envvars },
     fontManager_{},
     regularFont_{
         fontManager_.load(
@@ -58,7 +80,8 @@ Contour::Contour(Config const& _config) :
         bind(&Contour::onContentScale, this, _1, _2)
     },
     terminalView_{
-        config_.terminalSize,
+        terminal_,
+        process_,
         window_.width(),
         window_.height(),
         regularFont_.get(),
@@ -66,15 +89,17 @@ Contour::Contour(Config const& _config) :
         glm::vec4{0.9, 0.9, 0.9, 1.0}, // TODO: make cursor color configurable (part of color profile?)
         config_.colorProfile,
         config_.backgroundOpacity,
-        config_.shell,
         glm::ortho(0.0f, static_cast<GLfloat>(window_.width()), 0.0f, static_cast<GLfloat>(window_.height())),
         bind(&Contour::onScreenUpdate, this),
         logger_
     },
     configFileChangeWatcher_{
         _config.backingFilePath,
-        bind(&Contour::onConfigReload, this, _1)
-    }
+        [this, filePath = _config.backingFilePath](FileChangeWatcher::Event _event) {
+            onConfigReload(filePath, _event);
+        }
+    },
+    startTime_{ _startTime }
 {
     if (!loggingSink_.good())
         throw runtime_error{ "Failed to open log file." };
@@ -89,31 +114,72 @@ Contour::Contour(Config const& _config) :
     }
 
     terminalView_.setTabWidth(config_.tabWidth);
+    terminalView_.setAlternateScreenTimeout(config_.alternateScreenTimeout);
+    terminalView_.setCursorBlinking(config_.cursorBlinking);
+    prerasterizeZoomSteps(config_.fontSize);
 
     glViewport(0, 0, window_.width(), window_.height());
+
+    terminal::tracing::setThreadName("main");
+    terminal::tracing::setEnabled(config_.tracingEnabled);
+
+    terminalViewReady_.store(true);
 }
 
 Contour::~Contour()
 {
+    if (terminal::tracing::enabled())
+        writeTrace();
+}
+
+void Contour::writeTrace()
+{
+    try
+    {
+        terminal::tracing::writeChromeTrace(config_.traceFilePath.string());
+        cout << fmt::format("Trace written to: {}\n", config_.traceFilePath.string());
+    }
+    catch (exception const& e)
+    {
+        cerr << "Failed to write trace. " << e.what() << endl;
+    }
 }
 
 int Contour::main()
 {
     while (terminalView_.alive() && !glfwWindowShouldClose(window_))
     {
-        bool reloadPending = configReloadPending_.load();
+        if (bool const focused = glfwGetWindowAttrib(window_, GLFW_FOCUSED); focused != terminalView_.focused())
+            terminalView_.setFocused(focused);
+
         if (terminalView_.shouldRender())
             screenDirty_ = true;
-        if (reloadPending && atomic_compare_exchange_strong(&configReloadPending_, &reloadPending, false))
-        {
-            if (reloadConfigValues())
-                screenDirty_ = true;
-        }
+
+        auto newConfig = [this]() {
+            lock_guard<mutex> _l{ configLock_ };
+            auto config = move(pendingConfig_);
+            pendingConfig_.reset();
+            return config;
+        }();
+        if (newConfig && reloadConfigValues(move(*newConfig)))
+            screenDirty_ = true;
 
         if (screenDirty_)
             render();
         screenDirty_ = false;
-        glfwWaitEventsTimeout(0.5);
+
+        // Sleeps until the next event, waking up early only if the cursor is to blink or a resize is due.
+        auto const nextBlink = terminalView_.nextCursorBlink();
+        if (auto const timeout = terminal::idleTimeout({nextBlink, pendingResize_}); timeout)
+            glfwWaitEventsTimeout(chrono::duration<double>(*timeout).count());
+        else
+            glfwWaitEvents();
+
+        auto const now = chrono::steady_clock::now();
+        if (nextBlink && now >= *nextBlink)
+            screenDirty_ = true;
+        if (pendingResize_ && now >= *pendingResize_)
+            resizeTerminal();
     }
 
     return EXIT_SUCCESS;
@@ -130,13 +196,24 @@ inline glm::vec4 makeColor(terminal::RGBColor const& _color, terminal::Opacity _
 
 void Contour::render()
 {
+    TRACE_SCOPE("Contour.render");
+
     glm::vec4 const& bg = makeColor(config_.colorProfile.defaultBackground, config_.backgroundOpacity);
     glClearColor(bg.r, bg.g, bg.b, bg.a);
-    glClear(GL_COLOR_BUFFER_BIT);
 
-    terminalView_.render();
+    terminalView_.render(window_.bufferAge());
 
+    TRACE_SCOPE("Contour.swapBuffers");
     glfwSwapBuffers(window_);
+    terminalView_.inputLatency().framePresented();
+
+    if (!timeToFirstPaint_)
+    {
+        timeToFirstPaint_ = chrono::steady_clock::now() - startTime_;
+        timeline_.mark("first frame presented");
+        if (config_.startupTimeline)
+            cout << "Startup timeline:\n" << timeline_.summary();
+    }
 }
 
 void Contour::onContentScale(float _xs, float _ys)
@@ -147,7 +224,11 @@ void Contour::onContentScale(float _xs, float _ys)
 
 void Contour::onResize()
 {
-    terminalView_.resize(window_.width(), window_.height());
+    // The viewport follows right away, while the grid and the PTY are only resized once the window size
+    // settled, sparing the application a reflow and redraw for every step of dragging the window's border.
+    ++resizesRequested_;
+    pendingResize_ = chrono::steady_clock::now() + ResizeDelay;
+
     terminalView_.setProjection(
         glm::ortho(
             0.0f, static_cast<GLfloat>(window_.width()),
@@ -158,6 +239,14 @@ void Contour::onResize()
     render();
 }
 
+void Contour::resizeTerminal()
+{
+    pendingResize_.reset();
+    if (terminalView_.resize(window_.width(), window_.height()))
+        ++resizesPerformed_;
+    screenDirty_ = true;
+}
+
 optional<terminal::Key> glfwKeyToTerminalKey(int _key)
 {
     using terminal::Key;
@@ -296,6 +385,32 @@ void Contour::onKey(int _key, int _scanCode, int _action, int _mods)
             ofs << screenshot;
             keyHandled_ = true;
         }
+        // Print input latency statistics: ALT+CTRL+L
+        else if (_key == GLFW_KEY_L && modifier_ == (terminal::Modifier::Control + terminal::Modifier::Alt))
+        {
+            auto const& shapingCache = terminalView_.regularFont().shapingCache();
+            cout << terminalView_.inputLatency().summary() << endl;
+            cout << fmt::format("Shaping cache: {} hits, {} misses, {} entries\n",
+                                shapingCache.hits(), shapingCache.misses(), shapingCache.size());
+            cout << fmt::format("Grid resizes: {} performed, {} requested\n", resizesPerformed_, resizesRequested_);
+            if (timeToFirstPaint_)
+                cout << fmt::format("Time to first paint: {} ms\n",
+                                    chrono::duration_cast<chrono::milliseconds>(*timeToFirstPaint_).count());
+            keyHandled_ = true;
+        }
+        // Start tracing, or stop tracing and write the trace: ALT+CTRL+T
+        else if (_key == GLFW_KEY_T && modifier_ == (terminal::Modifier::Control + terminal::Modifier::Alt))
+        {
+            if (terminal::tracing::enabled())
+            {
+                terminal::tracing::setEnabled(false);
+                writeTrace();
+                terminal::tracing::clear();
+            }
+            else
+                terminal::tracing::setEnabled(true);
+            keyHandled_ = true;
+        }
         else if (_key == GLFW_KEY_EQUAL && modifier_ == (terminal::Modifier::Control + terminal::Modifier::Shift))
         {
             setFontSize(config_.fontSize + 1, true);
@@ -351,6 +466,7 @@ bool Contour::setFontSize(unsigned _fontSize, bool _resizeWindowIfNeeded)
         return false;
 
     config_.fontSize = _fontSize;
+    prerasterizeZoomSteps(_fontSize);
     if (!window_.fullscreen())
     {
         // resize window
@@ -367,6 +483,17 @@ bool Contour::setFontSize(unsigned _fontSize, bool _resizeWindowIfNeeded)
     return true;
 }
 
+void Contour::prerasterizeZoomSteps(unsigned _fontSize)
+{
+    // Zoom steps are taken in points, just like setFontSize() does, and then scaled to pixels.
+    auto const scale = Window::primaryMonitorContentScale().second;
+    auto const pixels = [&](unsigned _points) { return static_cast<unsigned>(_points * scale); };
+
+    terminalView_.prerasterize(pixels(_fontSize + 1));
+    if (_fontSize > 1)
+        terminalView_.prerasterize(pixels(_fontSize - 1));
+}
+
 void Contour::onChar(char32_t _char)
 {
     if (!keyHandled_)
@@ -380,59 +507,99 @@ void Contour::onScreenUpdate()
     glfwPostEmptyEvent();
 }
 
-void Contour::onConfigReload(FileChangeWatcher::Event _event)
+void Contour::onScreenCommands(vector<terminal::Command> const& _commands)
 {
-    configReloadPending_.store(true);
-    glfwPostEmptyEvent();
+    if (!shellOutputReceived_.exchange(true))
+        timeline_.mark("first shell output");
+
+    // Output received while starting up is rendered with the first frame.
+    if (terminalViewReady_.load())
+        terminalView_.onScreenUpdateHook(_commands);
 }
 
-bool Contour::reloadConfigValues()
+void Contour::onConfigReload(filesystem::path const& _filePath, FileChangeWatcher::Event _event)
 {
-    auto filePath = config_.backingFilePath.string();
+    if (_event == FileChangeWatcher::Event::Erased)
+        return;
+
+    // Parsed on this thread, so that the main loop does not block on it.
     auto newConfig = Config{};
     try
     {
-        loadConfigFromFile(newConfig, filePath);
+        loadConfigFromFile(newConfig, _filePath.string());
     }
     catch (exception const& e)
     {
         //TODO: logger_.error(e.what());
         cerr << "Failed to load configuration. " << e.what() << endl;
-        return false;
+        return;
     }
 
-    logger_ =
-        newConfig.logFilePath
-            ? GLLogger{newConfig.loggingMask, newConfig.logFilePath->string()}
-            : GLLogger{newConfig.loggingMask, &cout};
+    {
+        lock_guard<mutex> _l{ configLock_ };
+        pendingConfig_ = move(newConfig);
+    }
+    glfwPostEmptyEvent();
+}
 
-    bool windowResizeRequired = false;
+bool Contour::reloadConfigValues(Config _newConfig)
+{
+    auto const changes = diff(config_, _newConfig);
+
+    if (contains(changes, ConfigChange::Logging))
+        logger_ =
+            _newConfig.logFilePath
+                ? GLLogger{_newConfig.loggingMask, _newConfig.logFormat, _newConfig.logFilePath->string()}
+                : GLLogger{_newConfig.loggingMask, &cout};
+
+    if (contains(changes, ConfigChange::TabWidth))
+        terminalView_.setTabWidth(_newConfig.tabWidth);
 
-    terminalView_.setTabWidth(newConfig.tabWidth);
-    if (newConfig.fontFamily != config_.fontFamily)
+    if (contains(changes, ConfigChange::AlternateScreen))
+        terminalView_.setAlternateScreenTimeout(_newConfig.alternateScreenTimeout);
+
+    bool windowResizeRequired = false;
+    if (contains(changes, ConfigChange::FontFamily))
     {
         regularFont_ = fontManager_.load(
-            newConfig.fontFamily,
-            static_cast<unsigned>(newConfig.fontSize * Window::primaryMonitorContentScale().second)
+            _newConfig.fontFamily,
+            static_cast<unsigned>(_newConfig.fontSize * Window::primaryMonitorContentScale().second)
         );
         terminalView_.setFont(regularFont_.get());
+        prerasterizeZoomSteps(_newConfig.fontSize);
         windowResizeRequired = true;
     }
-    else if (newConfig.fontSize != config_.fontSize)
-        windowResizeRequired |= setFontSize(newConfig.fontSize, false);
+    else if (contains(changes, ConfigChange::FontSize))
+        windowResizeRequired |= setFontSize(_newConfig.fontSize, false);
 
-    if (newConfig.terminalSize != config_.terminalSize && !window_.fullscreen())
-        windowResizeRequired |= terminalView_.setTerminalSize(config_.terminalSize);
+    if (contains(changes, ConfigChange::TerminalSize) && !window_.fullscreen())
+        windowResizeRequired |= terminalView_.setTerminalSize(_newConfig.terminalSize);
 
     if (windowResizeRequired && !window_.fullscreen())
     {
-        auto const width = newConfig.terminalSize.columns * regularFont_.get().maxAdvance();
-        auto const height = newConfig.terminalSize.rows * regularFont_.get().lineHeight();
+        auto const width = _newConfig.terminalSize.columns * regularFont_.get().maxAdvance();
+        auto const height = _newConfig.terminalSize.rows * regularFont_.get().lineHeight();
         window_.resize(width, height);
     }
 
-    // TODO... (all the rest)
+    if (contains(changes, ConfigChange::Tracing))
+        terminal::tracing::setEnabled(_newConfig.tracingEnabled);
 
-    config_ = move(newConfig);
-    return true;
+    // Settings applied at startup only are taken over as well, to be saved or reported consistently.
+    config_ = move(_newConfig);
+
+    // The view refers to config_'s color profile, which therefore is to be updated first.
+    if (contains(changes, ConfigChange::ColorProfile))
+        terminalView_.setColorProfile(config_.colorProfile);
+
+    if (contains(changes, ConfigChange::BackgroundOpacity))
+        terminalView_.setBackgroundOpacity(config_.backgroundOpacity);
+
+    if (contains(changes, ConfigChange::CursorShape))
+        terminalView_.setCursorShape(config_.cursorShape);
+
+    if (contains(changes, ConfigChange::CursorBlinking))
+        terminalView_.setCursorBlinking(config_.cursorBlinking);
+
+    return changes != ConfigChange::None;
 }
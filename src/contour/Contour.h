@@ -16,22 +16,29 @@
 #include "Config.h"
 #include "Window.h"
 #include "FileChangeWatcher.h"
+#include "StartupTimeline.h"
 
 #include <terminal/InputGenerator.h>
+#include <terminal/Process.h>
+#include <terminal/Terminal.h>
 
 #include <glterminal/FontManager.h>
 #include <glterminal/GLLogger.h>
 #include <glterminal/GLTerminal.h>
 
 #include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
 
 class Contour {
   public:
-    explicit Contour(Config const& _config);
+    /// @param _startTime time the process started at, to measure the time until the first frame is presented.
+    Contour(Config const& _config, std::chrono::steady_clock::time_point _startTime);
     ~Contour();
 
     int main();
@@ -39,27 +46,62 @@ class Contour {
   private:
     void render();
     void onResize();
+    /// Resizes the terminal's grid and PTY to the window's current size.
+    void resizeTerminal();
     void onKey(int _key, int _scanCode, int _action, int _mods);
     void onChar(char32_t _char);
     void onMouseScroll(double _xOffset, double _yOffset);
     void onContentScale(float _xs, float _ys);
     void onScreenUpdate();
-    void onConfigReload(FileChangeWatcher::Event _event);
-    bool reloadConfigValues();
+    void onScreenCommands(std::vector<terminal::Command> const& _commands);
+    /// Loads the changed configuration file, invoked on the file watcher's thread.
+    void onConfigReload(std::filesystem::path const& _filePath, FileChangeWatcher::Event _event);
+
+    /// Applies the settings that differ from the current configuration.
+    ///
+    /// @returns whether anything changed.
+    bool reloadConfigValues(Config _newConfig);
     bool setFontSize(unsigned _fontSize, bool _resizeWindowIfNeeded);
+    /// Prepares the glyphs for zooming one step in or out of the given font size in points.
+    void prerasterizeZoomSteps(unsigned _fontSize);
+    void writeTrace();
     Font const& regularFont() const noexcept { return terminalView_.regularFont(); }
 
   private:
     std::ofstream loggingSink_;
     Config config_;
     GLLogger logger_;
+    StartupTimeline timeline_;
+    StartupTimeline::Mark configLoaded_{ timeline_, "configuration loaded" };
+
+    // Accessed by the screen update thread, hence initialized before terminal_ starts it.
+    std::atomic<bool> shellOutputReceived_ = false;
+    std::atomic<bool> terminalViewReady_ = false;
+
+    // The shell is started first, so that its startup overlaps with loading fonts and creating the window.
+    terminal::Terminal terminal_;
+    terminal::Process process_;
+    StartupTimeline::Mark shellStarted_{ timeline_, "shell started" };
+
     FontManager fontManager_;
     std::reference_wrapper<Font> regularFont_;
+    StartupTimeline::Mark fontsLoaded_{ timeline_, "fonts loaded" };
     Window window_;
+    StartupTimeline::Mark windowCreated_{ timeline_, "window created" };
     GLTerminal terminalView_;
+    StartupTimeline::Mark rendererReady_{ timeline_, "renderer ready" };
     bool keyHandled_ = false;
-    std::atomic<bool> configReloadPending_ = false;
+    std::mutex configLock_;
+    std::optional<Config> pendingConfig_; // loaded in the background, to be applied by the main loop
     FileChangeWatcher configFileChangeWatcher_;
     terminal::Modifier modifier_{};
     bool screenDirty_ = true;
+
+    /// Window resizes are applied to the grid and PTY only once no further resize came in for this long.
+    static constexpr std::chrono::milliseconds ResizeDelay{100};
+    std::optional<std::chrono::steady_clock::time_point> pendingResize_;
+    uint64_t resizesRequested_ = 0;     // window resizes reported
+    uint64_t resizesPerformed_ = 0;     // of which changed the number of lines or columns
+    std::chrono::steady_clock::time_point const startTime_;
+    std::optional<std::chrono::steady_clock::duration> timeToFirstPaint_;
 };
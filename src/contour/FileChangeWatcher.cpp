@@ -1,6 +1,17 @@
 #include "FileChangeWatcher.h"
 #include <thread>
 #include <chrono>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -8,6 +19,9 @@ FileChangeWatcher::FileChangeWatcher(filesystem::path _filePath, Notifier _notif
     filePath_{ move(_filePath) },
     notifier_{ move(_notifier) },
     exit_{ false },
+#if defined(__linux__)
+    stopEvent_{ eventfd(0, EFD_CLOEXEC) },
+#endif
     watcher_{ bind(&FileChangeWatcher::watch, this) }
 {
 }
@@ -16,9 +30,22 @@ FileChangeWatcher::~FileChangeWatcher()
 {
     stop();
     watcher_.join();
+#if defined(__linux__)
+    if (stopEvent_ != -1)
+        close(stopEvent_);
+#endif
 }
 
 void FileChangeWatcher::watch()
+{
+#if defined(__linux__)
+    if (watchDirectory())
+        return;
+#endif
+    poll();
+}
+
+void FileChangeWatcher::poll()
 {
     filesystem::file_time_type lastWriteTime = filesystem::last_write_time(filePath_);
     while (!exit_)
@@ -36,7 +63,119 @@ void FileChangeWatcher::watch()
     }
 }
 
+#if defined(__linux__)
+bool FileChangeWatcher::watchDirectory()
+{
+    if (stopEvent_ == -1)
+        return false;
+
+    int const fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd == -1)
+        return false;
+
+    auto constexpr mask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM;
+    auto const watchFile = [&](filesystem::path const& _file) {
+        auto const directory = _file.has_parent_path() ? _file.parent_path() : filesystem::path{"."};
+        return inotify_add_watch(fd, directory.c_str(), mask);
+    };
+
+    int const linkWatch = watchFile(filePath_);
+    if (linkWatch == -1)
+    {
+        close(fd);
+        return false;
+    }
+    auto const linkName = filePath_.filename().string();
+
+    // If the file is a symbolic link, changes are made to the file it points to, which may live
+    // in another directory. That one is watched as well, and re-resolved whenever the link changes.
+    // Both watches are the same if the file is not a link, as inotify has one watch per directory.
+    int targetWatch = -1;
+    filesystem::path target;
+    string targetName;
+    auto const resolveTarget = [&]() {
+        auto ec = error_code{};
+        auto resolved = filesystem::canonical(filePath_, ec);
+        if (ec)
+            resolved.clear();
+        if (resolved == target)
+            return;
+
+        if (targetWatch != -1 && targetWatch != linkWatch)
+            inotify_rm_watch(fd, targetWatch);
+        target = move(resolved);
+        targetName = target.filename().string();
+        targetWatch = target.empty() ? -1 : watchFile(target);
+    };
+    resolveTarget();
+
+    using Clock = chrono::steady_clock;
+    optional<Event> pending;
+    Clock::time_point deadline;
+
+    alignas(inotify_event) char buffer[4096];
+    while (!exit_)
+    {
+        int timeout = -1;
+        if (pending)
+            timeout = static_cast<int>(max<chrono::milliseconds::rep>(
+                chrono::ceil<chrono::milliseconds>(deadline - Clock::now()).count(), 0));
+
+        pollfd fds[2] = {{fd, POLLIN, 0}, {stopEvent_, POLLIN, 0}};
+        if (::poll(fds, 2, timeout) == -1 && errno != EINTR)
+            break;
+
+        if (fds[1].revents)
+            break;
+
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t n;
+            while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char const* p = buffer; p < buffer + n;)
+                {
+                    auto const event = reinterpret_cast<inotify_event const*>(p);
+                    p += sizeof(inotify_event) + event->len;
+
+                    if (!event->len)
+                        continue;
+
+                    bool const isLink = event->wd == linkWatch && linkName == event->name;
+                    bool const isTarget = event->wd == targetWatch && targetName == event->name;
+                    if (!isLink && !isTarget)
+                        continue;
+
+                    if (isLink)
+                        resolveTarget();
+
+                    // The most recent change counts, such as the file being written again after deletion.
+                    pending = (event->mask & (IN_DELETE | IN_MOVED_FROM)) ? Event::Erased : Event::Modified;
+                    deadline = Clock::now() + DebounceDelay;
+                }
+            }
+        }
+
+        if (pending && Clock::now() >= deadline)
+        {
+            notifier_(*pending);
+            pending.reset();
+        }
+    }
+
+    close(fd);
+    return true;
+}
+#endif
+
 void FileChangeWatcher::stop()
 {
     exit_ = true;
+#if defined(__linux__)
+    if (stopEvent_ != -1)
+    {
+        uint64_t const value = 1;
+        [[maybe_unused]] auto const n = write(stopEvent_, &value, sizeof(value));
+    }
+#endif
 }
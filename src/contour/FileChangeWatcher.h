@@ -1,9 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <filesystem>
 #include <thread>
 
+/// Watches a single file for modification and removal.
+///
+/// On Linux, the file's directory is watched via inotify, also catching files being replaced
+/// by renaming another file onto them, as editors commonly save. Bursts of changes are reported once,
+/// after DebounceDelay passed without further changes. Elsewhere, the file is polled every second.
 class FileChangeWatcher {
   public:
     enum class Event {
@@ -12,6 +19,8 @@ class FileChangeWatcher {
     };
     using Notifier = std::function<void(Event)>;
 
+    static constexpr std::chrono::milliseconds DebounceDelay{50};
+
     FileChangeWatcher(std::filesystem::path _filePath, Notifier _notifier);
     ~FileChangeWatcher();
 
@@ -21,9 +30,20 @@ class FileChangeWatcher {
   private:
     void watch();
 
+    /// Watches by polling the file's status.
+    void poll();
+
+#if defined(__linux__)
+    /// Watches via inotify, returning false right away if not available.
+    bool watchDirectory();
+#endif
+
   private:
     std::filesystem::path filePath_;
     Notifier notifier_;
-    bool exit_;
+    std::atomic<bool> exit_;
+#if defined(__linux__)
+    int stopEvent_;     // eventfd signaled by stop()
+#endif
     std::thread watcher_;
 };
@@ -0,0 +1,37 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "StartupTimeline.h"
+
+#include <fmt/format.h>
+
+using namespace std;
+
+void StartupTimeline::mark(string _phase)
+{
+    auto const now = Clock::now();
+    lock_guard<mutex> _l{ lock_ };
+    phases_.emplace_back(now, move(_phase));
+}
+
+string StartupTimeline::summary() const
+{
+    lock_guard<mutex> _l{ lock_ };
+
+    auto result = string{};
+    for (auto const& [time, phase] : phases_)
+        result += fmt::format("{:>9.3f} ms  {}\n",
+                              chrono::duration<double, milli>(time - start_).count(),
+                              phase);
+    return result;
+}
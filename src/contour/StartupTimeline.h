@@ -0,0 +1,44 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Records when each phase of startup was reached, relative to process start.
+class StartupTimeline {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StartupTimeline(Clock::time_point _start) : start_{ _start } {}
+
+    /// Records that the given phase has been reached. Safe to be called from any thread.
+    void mark(std::string _phase);
+
+    /// @returns one line per phase reached, in order, with its time since process start.
+    std::string summary() const;
+
+    /// Records a phase upon construction, for marking phases between the construction of class members.
+    struct Mark {
+        Mark(StartupTimeline& _timeline, std::string _phase) { _timeline.mark(std::move(_phase)); }
+    };
+
+  private:
+    Clock::time_point const start_;
+    mutable std::mutex lock_;
+    std::vector<std::pair<Clock::time_point, std::string>> phases_;
+};
@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 #include "Window.h"
+#include "BufferAge.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -74,6 +75,7 @@ Window::Window(Size const& _size, string const& _title,
     }
 
     glfwMakeContextCurrent(window_);
+    bufferAgeSupported_ = bufferAgeSupported(window_);
 
     if (GLenum e = glewInit(); e != GLEW_OK)
         throw runtime_error{ string{"Could not initialize GLEW. "} +((char*)glewGetErrorString(e)) };
@@ -102,6 +104,11 @@ Window::~Window()
     glfwTerminate();
 }
 
+unsigned Window::bufferAge() const
+{
+    return bufferAgeSupported_ ? queryBufferAge(window_) : 0;
+}
+
 bool Window::enableBackgroundBlur()
 {
 #if defined(_WIN32)
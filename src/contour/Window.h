@@ -54,6 +54,9 @@ class Window {
     static std::pair<float, float> primaryMonitorContentScale();
     std::pair<float, float> contentScale();
 
+    /// @returns the number of frames since the back buffer was presented, or 0 if unknown.
+    unsigned bufferAge() const;
+
     bool fullscreen() const noexcept { return fullscreen_; }
     void toggleFullScreen();
 
@@ -67,6 +70,7 @@ class Window {
 
   private:
     GLFWwindow* window_;
+    bool bufferAgeSupported_ = false;
     bool fullscreen_ = false;
     Size size_;
     Size lastSize_;
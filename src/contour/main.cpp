@@ -15,6 +15,7 @@
 #include "Flags.h"
 #include "Config.h"
 
+#include <glterminal/DiskCache.h>
 #include <glterminal/GLLogger.h>
 #include <terminal/InputGenerator.h>
 #include <terminal/OutputGenerator.h>
@@ -23,6 +24,7 @@
 #include <terminal/UTF8.h>
 #include <terminal/Util.h>
 
+#include <chrono>
 #include <iostream>
 
 #if defined(__unix__)
@@ -33,13 +35,20 @@ using namespace std;
 
 int main(int argc, char const* argv[])
 {
+    auto const startTime = chrono::steady_clock::now();
+
     try
     {
+        // Font discovery is one of the most expensive parts of startup, get it going right away.
+        FontManager::preload();
+
         auto config = Config{};
         if (auto exitStatus = loadConfigFromCLI(config, argc, argv); exitStatus.has_value())
             return *exitStatus;
 
-        auto myterm = Contour{config};
+        DiskCache::setDirectory(config.cacheDirectory);
+
+        auto myterm = Contour{config, startTime};
         return myterm.main();
     }
     catch (exception const& e)
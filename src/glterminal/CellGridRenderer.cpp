@@ -0,0 +1,450 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/CellGridRenderer.h>
+#include <glterminal/GLTextShaper.h>
+
+#include <terminal/Tracer.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+// The cell comparison below relies on the instance data being free of padding bytes.
+static_assert(sizeof(CellGridRenderer::Cell) == 48);
+
+// The fragment shader below samples from at most four atlas pages.
+static_assert(GLTextShaper::MaxAtlasPages <= 4);
+
+auto constexpr vertexShader = R"(
+    // Vertex Shader
+    #version 330
+    layout (location = 0) in vec4 a_glyphRect;
+    layout (location = 1) in vec4 a_uv;
+    layout (location = 2) in vec4 a_foreground;
+    layout (location = 3) in vec4 a_background;
+    layout (location = 4) in uint a_page;
+    layout (location = 5) in uint a_flags;
+
+    uniform mat4 u_projection;
+    uniform vec2 u_cellSize;
+    uniform ivec2 u_gridSize;   // columns, rows
+    uniform int u_pass;         // 0: backgrounds, 1: glyphs
+    uniform int u_firstSlot;    // index of the first drawn instance within the ring of rows
+    uniform int u_rowOffset;    // ring row holding the top grid row
+
+    out vec2 v_texCoord;
+    out vec2 v_cellCoord;
+    out vec4 v_foreground;
+    out vec4 v_background;
+    flat out uint v_page;
+    flat out uint v_flags;
+
+    void main()
+    {
+        // corners of a triangle strip: (0,0), (1,0), (0,1), (1,1)
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        int slot = u_firstSlot + gl_InstanceID;
+        int column = slot % u_gridSize.x;
+        int row = (slot / u_gridSize.x - u_rowOffset + u_gridSize.y) % u_gridSize.y;
+        vec2 cellOrigin = vec2(column, u_gridSize.y - 1 - row) * u_cellSize;
+
+        vec2 pos;
+        if (u_pass == 0)
+            pos = cellOrigin + corner * u_cellSize;
+        else
+        {
+            // cells without a glyph collapse into an empty quad
+            vec4 rect = (a_flags & 1u) != 0u ? a_glyphRect : vec4(0.0);
+            pos = cellOrigin + rect.xy + corner * rect.zw;
+        }
+
+        gl_Position = u_projection * vec4(pos, 0.0, 1.0);
+        v_texCoord = vec2(mix(a_uv.x, a_uv.z, corner.x), mix(a_uv.w, a_uv.y, corner.y));
+        v_cellCoord = corner * u_cellSize;
+        v_foreground = a_foreground;
+        v_background = a_background;
+        v_page = a_page;
+        v_flags = a_flags;
+    }
+)";
+
+auto constexpr fragmentShader = R"(
+    // Fragment Shader
+    #version 330
+    in vec2 v_texCoord;
+    in vec2 v_cellCoord;
+    in vec4 v_foreground;
+    in vec4 v_background;
+    flat in uint v_page;
+    flat in uint v_flags;
+
+    uniform vec2 u_cellSize;
+    uniform int u_pass;
+    uniform sampler2D u_atlas0;
+    uniform sampler2D u_atlas1;
+    uniform sampler2D u_atlas2;
+    uniform sampler2D u_atlas3;
+
+    out vec4 outColor;
+
+    bool inBand(float _y, float _from, float _thickness)
+    {
+        return _y >= _from && _y < _from + _thickness;
+    }
+
+    void main()
+    {
+        if (u_pass == 0)
+        {
+            float t = max(1.0, floor(u_cellSize.y / 16.0));
+            float y = v_cellCoord.y;
+            bool decorated = ((v_flags & 2u) != 0u && inBand(y, t, t))
+                          || ((v_flags & 4u) != 0u && (inBand(y, t, t) || inBand(y, 3.0 * t, t)))
+                          || ((v_flags & 8u) != 0u && inBand(y, floor(u_cellSize.y / 2.0), t));
+            outColor = decorated ? v_foreground : v_background;
+        }
+        else
+        {
+            float alpha;
+            if (v_page == 0u)
+                alpha = texture(u_atlas0, v_texCoord).r;
+            else if (v_page == 1u)
+                alpha = texture(u_atlas1, v_texCoord).r;
+            else if (v_page == 2u)
+                alpha = texture(u_atlas2, v_texCoord).r;
+            else
+                alpha = texture(u_atlas3, v_texCoord).r;
+            outColor = vec4(v_foreground.rgb, v_foreground.a * alpha);
+        }
+    }
+)";
+
+CellGridRenderer::CellGridRenderer(terminal::WindowSize const& _size, glm::ivec2 _cellSize) :
+    size_{ _size },
+    shader_{ vertexShader, fragmentShader },
+    projectionLocation_{ shader_.uniformLocation("u_projection") },
+    cellSizeLocation_{ shader_.uniformLocation("u_cellSize") },
+    gridSizeLocation_{ shader_.uniformLocation("u_gridSize") },
+    passLocation_{ shader_.uniformLocation("u_pass") },
+    firstSlotLocation_{ shader_.uniformLocation("u_firstSlot") },
+    rowOffsetLocation_{ shader_.uniformLocation("u_rowOffset") },
+    cells_(_size.rows * _size.columns),
+    uploaded_{},
+    dirty_(_size.rows, true)
+{
+    shader_.use();
+    for (unsigned i = 0; i < 4; ++i)
+        shader_.setInt("u_atlas" + to_string(i), static_cast<int>(i));
+
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+
+    glGenBuffers(1, &vbo_);
+
+    // Instance data layout is specified with each draw, as it depends on the first drawn row.
+    for (GLuint index = 0; index < 6; ++index)
+    {
+        glVertexAttribDivisor(index, 1);
+        glEnableVertexAttribArray(index);
+    }
+
+    glBindVertexArray(0);
+
+    for (auto& framebuffer : framebuffers_)
+    {
+        glGenFramebuffers(1, &framebuffer.fbo);
+        glGenRenderbuffers(1, &framebuffer.colorBuffer);
+    }
+
+    setCellSize(_cellSize);
+}
+
+CellGridRenderer::~CellGridRenderer()
+{
+    for (auto& framebuffer : framebuffers_)
+    {
+        glDeleteRenderbuffers(1, &framebuffer.colorBuffer);
+        glDeleteFramebuffers(1, &framebuffer.fbo);
+    }
+    glDeleteBuffers(1, &vbo_);
+    glDeleteVertexArrays(1, &vao_);
+}
+
+void CellGridRenderer::resize(terminal::WindowSize const& _size)
+{
+    size_ = _size;
+    cells_.assign(_size.rows * _size.columns, Cell{});
+    uploaded_.clear();
+    dirty_.assign(_size.rows, true);
+    reallocate_ = true;
+}
+
+void CellGridRenderer::setCellSize(glm::ivec2 _cellSize)
+{
+    cellSize_ = _cellSize;
+    shader_.use();
+    shader_.setVec2(cellSizeLocation_, glm::vec2(_cellSize));
+}
+
+void CellGridRenderer::allocateFramebuffers()
+{
+    auto const size = glm::ivec2{size_.columns * cellSize_.x, size_.rows * cellSize_.y};
+    if (size == framebufferSize_)
+        return;
+
+    TRACE_SCOPE("CellGridRenderer.allocateFramebuffers");
+
+    for (auto& framebuffer : framebuffers_)
+    {
+        glBindRenderbuffer(GL_RENDERBUFFER, framebuffer.colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, framebuffer.colorBuffer);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    framebufferSize_ = size;
+    fill(begin(dirty_), end(dirty_), true);
+
+    shader_.use();
+    shader_.setMat4(projectionLocation_, glm::ortho(0.0f, static_cast<GLfloat>(size.x),
+                                                    0.0f, static_cast<GLfloat>(size.y)));
+}
+
+bool CellGridRenderer::scroll()
+{
+    auto const lines = pendingScroll_;
+    pendingScroll_ = 0;
+
+    // Nothing retained is worth moving then.
+    if (reallocate_ || lines == 0 || lines >= size_.rows)
+        return false;
+
+    TRACE_SCOPE("CellGridRenderer.scroll");
+
+    // The rows moved along with their ring slots, so their uploaded contents are still in place.
+    rowOffset_ = (rowOffset_ + lines) % size_.rows;
+
+    // Moves the retained image up. Source and destination overlap, so it is moved into the back
+    // framebuffer, which then becomes the front one.
+    auto const distance = static_cast<GLint>(lines) * cellSize_.y;
+    auto const& [front, back] = framebuffers_;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, front.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, back.fbo);
+    glBlitFramebuffer(0, 0, framebufferSize_.x, framebufferSize_.y - distance,
+                      0, distance, framebufferSize_.x, framebufferSize_.y,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    swap(framebuffers_[0], framebuffers_[1]);
+
+    // The newly exposed rows at the bottom show nothing yet.
+    fill(end(dirty_) - lines, end(dirty_), true);
+    return true;
+}
+
+void CellGridRenderer::upload()
+{
+    TRACE_SCOPE("CellGridRenderer.upload");
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+
+    uploadedRows_ = 0;
+    if (reallocate_)
+    {
+        glBufferData(GL_ARRAY_BUFFER, cells_.size() * sizeof(Cell), cells_.data(), GL_DYNAMIC_DRAW);
+        uploaded_ = cells_;
+        rowOffset_ = 0;
+        uploadedRows_ = size_.rows;
+        fill(begin(dirty_), end(dirty_), true);
+        reallocate_ = false;
+        return;
+    }
+
+    // Uploads changed rows that are consecutive in the ring with a single call each.
+    size_t const rowSize = size_.columns;
+    size_t firstSlot = 0;
+    size_t slotCount = 0;
+    auto const flush = [&]() {
+        if (!slotCount)
+            return;
+        auto const offset = firstSlot * rowSize;
+        glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(Cell), slotCount * rowSize * sizeof(Cell), &uploaded_[offset]);
+        slotCount = 0;
+    };
+
+    for (size_t row = 0; row < size_.rows; ++row)
+    {
+        auto const slot = slotOf(row);
+        auto const cells = &cells_[row * rowSize];
+        auto const uploaded = &uploaded_[slot * rowSize];
+        if (memcmp(cells, uploaded, rowSize * sizeof(Cell)) == 0)
+        {
+            flush();
+            continue;
+        }
+
+        copy_n(cells, rowSize, uploaded);
+        dirty_[row] = true;
+        ++uploadedRows_;
+
+        if (slotCount && slot != firstSlot + slotCount)
+            flush();
+        if (!slotCount)
+            firstSlot = slot;
+        ++slotCount;
+    }
+    flush();
+}
+
+void CellGridRenderer::drawRows(size_t _first, size_t _last)
+{
+    // Consecutive grid rows are consecutive in the ring, unless they wrap around its end.
+    size_t const rowSize = size_.columns;
+    for (size_t row = _first; row < _last;)
+    {
+        auto const slot = slotOf(row);
+        auto const count = min(_last - row, size_.rows - slot);
+
+        auto const stride = static_cast<GLsizei>(sizeof(Cell));
+        auto const base = slot * rowSize * sizeof(Cell);
+        auto const offset = [base](size_t _member) { return reinterpret_cast<void const*>(base + _member); };
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, offset(offsetof(Cell, glyphRect)));
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, offset(offsetof(Cell, uv)));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset(offsetof(Cell, foreground)));
+        glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset(offsetof(Cell, background)));
+        glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, stride, offset(offsetof(Cell, page)));
+        glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, stride, offset(offsetof(Cell, flags)));
+
+        glUniform1i(firstSlotLocation_, static_cast<GLint>(slot * rowSize));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count * rowSize));
+        row += count;
+    }
+}
+
+void CellGridRenderer::draw()
+{
+    TRACE_SCOPE("CellGridRenderer.draw");
+
+    // Glyphs may reach into the rows next to their own. Rows next to changed ones are
+    // therefore drawn again as well, and glyphs of one more row on either side are drawn into them.
+    drawn_ = dirty_;
+    for (size_t row = 0; row < size_.rows; ++row)
+        if (dirty_[row])
+        {
+            if (row > 0)
+                drawn_[row - 1] = true;
+            if (row + 1 < size_.rows)
+                drawn_[row + 1] = true;
+        }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers_[0].fbo);
+    glViewport(0, 0, framebufferSize_.x, framebufferSize_.y);
+    glEnable(GL_SCISSOR_TEST);
+
+    glUniform1i(rowOffsetLocation_, static_cast<GLint>(rowOffset_));
+
+    for (size_t row = 0; row < size_.rows;)
+    {
+        if (!drawn_[row])
+        {
+            ++row;
+            continue;
+        }
+
+        size_t const first = row;
+        while (row < size_.rows && drawn_[row])
+            ++row;
+        size_t const last = row;
+
+        // Starts off the rows as the screen is cleared, for backgrounds to be blended the same way.
+        glScissor(0, static_cast<GLint>(size_.rows - last) * cellSize_.y,
+                  framebufferSize_.x, static_cast<GLint>(last - first) * cellSize_.y);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glUniform1i(passLocation_, 0);
+        drawRows(first, last);
+
+        glUniform1i(passLocation_, 1);
+        drawRows(first > 0 ? first - 1 : first, min(last + 1, size_t{size_.rows}));
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    fill(begin(dirty_), end(dirty_), false);
+}
+
+void CellGridRenderer::render(TextureAtlas const& _atlas)
+{
+    TRACE_SCOPE("CellGridRenderer.render");
+
+    if (cells_.empty())
+    {
+        drawn_.clear();
+        return;
+    }
+
+    GLint targetFramebuffer{};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+    array<GLint, 4> viewport{};
+    glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+    allocateFramebuffers();
+    bool const scrolled = scroll();
+    upload();
+
+    shader_.use();
+    glUniform2i(gridSizeLocation_, size_.columns, size_.rows);
+
+    auto const pageCount = min(_atlas.pageCount(), size_t{4});
+    for (unsigned page = 0; page < pageCount; ++page)
+    {
+        glActiveTexture(GL_TEXTURE0 + page);
+        glBindTexture(GL_TEXTURE_2D, _atlas.texture(page));
+    }
+
+    glBindVertexArray(vao_);
+    draw();
+    glActiveTexture(GL_TEXTURE0);
+
+    // Rows that moved along with the image were not drawn again, yet differ from what
+    // the window shows, so they are reported as changed.
+    if (scrolled)
+        fill(begin(drawn_), end(drawn_), true);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(targetFramebuffer));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    #if !defined(NDEBUG)
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #endif
+}
+
+void CellGridRenderer::present()
+{
+    if (cells_.empty())
+        return;
+
+    GLint targetFramebuffer{};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers_[0].fbo);
+    glBlitFramebuffer(0, 0, framebufferSize_.x, framebufferSize_.y,
+                      origin_.x, origin_.y, origin_.x + framebufferSize_.x, origin_.y + framebufferSize_.y,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(targetFramebuffer));
+}
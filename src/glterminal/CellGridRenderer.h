@@ -0,0 +1,155 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <glterminal/Shader.h>
+#include <glterminal/TextureAtlas.h>
+
+#include <terminal/Commands.h>
+#include <terminal/WindowSize.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+/**
+ * Renders the whole cell grid of a terminal with one instanced draw call for all cell backgrounds
+ * and one for all glyphs.
+ *
+ * Each cell is one instance in a persistent GPU buffer. The cell's grid position is derived from
+ * the instance ID, so only its visual attributes are stored. Between frames, only rows whose
+ * contents changed are uploaded again.
+ *
+ * The rendered grid is retained in an offscreen framebuffer and copied to the screen by present(),
+ * so that only changed rows are drawn again. The instance buffer is used as a ring of rows:
+ * when the screen scrolled, the ring is rotated and the retained image is moved up by blitting it,
+ * leaving only the newly exposed rows to be uploaded and drawn.
+ */
+class CellGridRenderer {
+  public:
+    enum Flags : GLuint {
+        HasGlyph = 1 << 0,
+        Underline = 1 << 1,
+        DoublyUnderlined = 1 << 2,
+        CrossedOut = 1 << 3,
+    };
+
+    /// Per-instance attributes of a single grid cell.
+    struct Cell {
+        std::array<GLfloat, 4> glyphRect{};     //!< left, bottom, width, height in pixels, relative to the cell
+        std::array<GLfloat, 4> uv{};            //!< left, top, right, bottom atlas texture coordinates
+        GLuint foreground{};                    //!< RGBA, as packed by terminal::pack()
+        GLuint background{};                    //!< RGBA, as packed by terminal::pack()
+        GLuint page{};                          //!< atlas page holding the glyph
+        GLuint flags{};                         //!< bitmask of Flags
+    };
+
+    CellGridRenderer(terminal::WindowSize const& _size, glm::ivec2 _cellSize);
+    CellGridRenderer(CellGridRenderer const&) = delete;
+    CellGridRenderer& operator=(CellGridRenderer const&) = delete;
+    ~CellGridRenderer();
+
+    terminal::WindowSize const& size() const noexcept { return size_; }
+
+    /// Resizes the grid, resetting all cells.
+    void resize(terminal::WindowSize const& _size);
+
+    void setCellSize(glm::ivec2 _cellSize);
+
+    /// Sets the pixel position of the bottom left corner of the grid within the target framebuffer.
+    void setOrigin(glm::ivec2 _origin) noexcept { origin_ = _origin; }
+
+    /// Hints that the screen contents moved up by the given number of lines since the last frame.
+    ///
+    /// The next render() then moves the retained image instead of drawing the moved rows again.
+    /// Rows are still compared against their previous contents, so a wrong hint costs performance only.
+    void scrollUp(unsigned _lines) noexcept { pendingScroll_ += _lines; }
+
+    /// @returns the cell at the given 1-based position, to be filled for the next frame.
+    Cell& at(terminal::cursor_pos_t _row, terminal::cursor_pos_t _column) noexcept
+    {
+        return cells_[(_row - 1) * size_.columns + (_column - 1)];
+    }
+
+    /// Uploads and draws all rows that changed since the last call into the retained image.
+    ///
+    /// @param _atlas texture atlas the cells' glyph coordinates refer to.
+    void render(TextureAtlas const& _atlas);
+
+    /// Copies the retained image into the currently bound framebuffer, subject to the scissor test.
+    void present();
+
+    /// Number of rows uploaded by the most recent render() call.
+    unsigned uploadedRows() const noexcept { return uploadedRows_; }
+
+    /// 0-based grid rows whose pixels changed by the most recent render() call.
+    ///
+    /// These are all rows when the retained image was moved by a scroll.
+    std::vector<bool> const& drawnRows() const noexcept { return drawn_; }
+
+  private:
+    /// Index of the instance buffer row holding the given 0-based grid row.
+    size_t slotOf(size_t _row) const noexcept { return (_row + rowOffset_) % size_.rows; }
+
+    /// (Re)allocates the offscreen framebuffers if the grid's pixel size changed.
+    void allocateFramebuffers();
+
+    /// Rotates the ring of rows and moves the retained image up by the pending scroll hint.
+    ///
+    /// @returns whether or not the retained image was moved.
+    bool scroll();
+
+    void upload();
+
+    /// Draws the dirty rows into the front framebuffer.
+    void draw();
+
+    /// Draws the given range of 0-based grid rows, in the currently active pass.
+    void drawRows(size_t _first, size_t _last);
+
+  private:
+    struct Framebuffer {
+        GLuint fbo{};
+        GLuint colorBuffer{};
+    };
+
+  private:
+    terminal::WindowSize size_;
+    Shader shader_;
+    GLint const projectionLocation_;
+    GLint const cellSizeLocation_;
+    GLint const gridSizeLocation_;
+    GLint const passLocation_;
+    GLint const firstSlotLocation_;
+    GLint const rowOffsetLocation_;
+    GLuint vbo_{};
+    GLuint vao_{};
+
+    glm::ivec2 cellSize_{};
+    glm::ivec2 origin_{};
+
+    std::array<Framebuffer, 2> framebuffers_{}; // front one holds the retained image, back one is the blit target
+    glm::ivec2 framebufferSize_{};
+
+    std::vector<Cell> cells_;       // cells of the frame being built, in grid order
+    std::vector<Cell> uploaded_;    // cells as currently stored in vbo_, in ring order
+    std::vector<bool> dirty_;       // grid rows to be drawn again
+    size_t rowOffset_ = 0;          // ring slot of the top grid row
+    unsigned pendingScroll_ = 0;    // lines scrolled since the last frame
+    bool reallocate_ = true;        // whether or not vbo_ must be resized before uploading
+    std::vector<bool> drawn_;       // grid rows changed by the last render() call
+    unsigned uploadedRows_ = 0;
+};
@@ -0,0 +1,72 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/DiskCache.h>
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+
+optional<filesystem::path> DiskCache::directory_{};
+
+void DiskCache::setDirectory(optional<filesystem::path> _directory)
+{
+    directory_ = move(_directory);
+}
+
+filesystem::path DiskCache::entryPath(string_view _category, uint64_t _key)
+{
+    return *directory_ / _category / fmt::format("{:016x}", _key);
+}
+
+optional<vector<uint8_t>> DiskCache::read(string_view _category, uint64_t _key)
+{
+    if (!directory_)
+        return nullopt;
+
+    auto input = ifstream{ entryPath(_category, _key), ios::binary };
+    if (!input.good())
+        return nullopt;
+
+    auto data = vector<uint8_t>(istreambuf_iterator<char>{input}, istreambuf_iterator<char>{});
+    if (input.bad())
+        return nullopt;
+
+    return { move(data) };
+}
+
+void DiskCache::write(string_view _category, uint64_t _key, vector<uint8_t> const& _data)
+{
+    if (!directory_)
+        return;
+
+    auto const filePath = entryPath(_category, _key);
+    auto const tempFilePath = filesystem::path{filePath.string() + ".tmp"};
+
+    auto ec = error_code{};
+    filesystem::create_directories(filePath.parent_path(), ec);
+    {
+        auto output = ofstream{ tempFilePath, ios::binary | ios::trunc };
+        output.write(reinterpret_cast<char const*>(_data.data()), static_cast<streamsize>(_data.size()));
+        if (!output.good())
+        {
+            output.close();
+            filesystem::remove(tempFilePath, ec);
+            return;
+        }
+    }
+    filesystem::rename(tempFilePath, filePath, ec);
+}
@@ -0,0 +1,56 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Optional on-disk cache of resources that are expensive to build on startup,
+ * such as linked shader programs and prerasterized glyphs.
+ *
+ * Entries are files named by category and key. Callers are responsible for keying entries by everything
+ * their contents depend on, and for validating what they read back. Any failure to read or write an entry
+ * is treated as a cache miss, so the cache never keeps anything from working without it.
+ */
+class DiskCache {
+  public:
+    /// Sets the directory to keep cache entries in, or disables caching if none given (the default).
+    static void setDirectory(std::optional<std::filesystem::path> _directory);
+
+    static bool enabled() noexcept { return directory_.has_value(); }
+
+    /// @returns the contents of the given entry, or std::nullopt if it does not exist.
+    static std::optional<std::vector<uint8_t>> read(std::string_view _category, uint64_t _key);
+
+    /// Stores the given entry, atomically replacing any previous contents.
+    static void write(std::string_view _category, uint64_t _key, std::vector<uint8_t> const& _data);
+
+    /// Computes a stable (across runs and platforms) 64-bit FNV-1a hash, to build keys with.
+    static uint64_t hash(std::string_view _data, uint64_t _seed = 0xcbf29ce484222325ull) noexcept
+    {
+        for (char const ch : _data)
+            _seed = (_seed ^ static_cast<uint8_t>(ch)) * 0x100000001b3ull;
+        return _seed;
+    }
+
+  private:
+    static std::filesystem::path entryPath(std::string_view _category, uint64_t _key);
+
+    static std::optional<std::filesystem::path> directory_;
+};
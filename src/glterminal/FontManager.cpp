@@ -16,7 +16,14 @@
 #include <harfbuzz/hb.h>
 #include <harfbuzz/hb-ft.h>
 
+#include <terminal/Tracer.h>
+
+#include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
 
 #if defined(__linux__)
 #define HAVE_FONTCONFIG
@@ -28,6 +35,12 @@
 
 using namespace std;
 
+/// Maximum number of text runs to keep the shaping results for, per font.
+constexpr size_t ShapingCacheCapacity = 4096;
+
+/// Maximum number of fonts to fall back to for characters not contained in the primary font.
+constexpr size_t MaxFallbackFonts = 16;
+
 static string freetypeErrorString(FT_Error _errorCode)
 {
     #undef __FTERRORS_H__
@@ -51,33 +64,126 @@ static bool endsWidthIgnoreCase(string const& _text, string const& _suffix)
     return true;
 }
 
-static string getFontFilePath([[maybe_unused]] string const& _fontPattern)
+#if defined(HAVE_FONTCONFIG)
+/// @returns the process wide fontconfig configuration, as being loaded.
+///
+/// Loading it reads all of fontconfig's configuration and font caches, which easily takes
+/// a hundred milliseconds, so it is done only once, on a background thread started by the first call.
+/// The configuration is kept until the process exits.
+static shared_future<FcConfig*> const& sharedFcConfigFuture()
+{
+    static shared_future<FcConfig*> const config = async(launch::async, []() {
+        terminal::tracing::setThreadName("fontconfig");
+        TRACE_SCOPE("FcInitLoadConfigAndFonts");
+        return FcInitLoadConfigAndFonts();
+    }).share();
+
+    return config;
+}
+
+static FcConfig* sharedFcConfig()
+{
+    return sharedFcConfigFuture().get();
+}
+
+/// @returns the newest modification time of fontconfig's configuration and cache directories.
+///
+/// Installing or removing fonts updates fontconfig's caches (via fc-cache), which is what cached font
+/// file paths are validated against.
+static int64_t fontconfigTimestamp()
+{
+    auto dirs = vector<filesystem::path>{
+        "/etc/fonts",
+        "/etc/fonts/conf.d",
+        "/var/cache/fontconfig",
+        "/usr/lib/fontconfig/cache",
+    };
+
+    if (char const* home = getenv("HOME"); home && *home)
+    {
+        dirs.emplace_back(filesystem::path{home} / ".fontconfig");
+        if (char const* configHome = getenv("XDG_CONFIG_HOME"); !configHome || !*configHome)
+            dirs.emplace_back(filesystem::path{home} / ".config" / "fontconfig");
+        if (char const* cacheHome = getenv("XDG_CACHE_HOME"); !cacheHome || !*cacheHome)
+            dirs.emplace_back(filesystem::path{home} / ".cache" / "fontconfig");
+    }
+    if (char const* configHome = getenv("XDG_CONFIG_HOME"); configHome && *configHome)
+        dirs.emplace_back(filesystem::path{configHome} / "fontconfig");
+    if (char const* cacheHome = getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome)
+        dirs.emplace_back(filesystem::path{cacheHome} / "fontconfig");
+
+    int64_t timestamp = 0;
+    for (auto const& dir : dirs)
+    {
+        auto ec = error_code{};
+        auto const lastWriteTime = filesystem::last_write_time(dir, ec);
+        if (!ec)
+            timestamp = max(timestamp, static_cast<int64_t>(lastWriteTime.time_since_epoch().count()));
+    }
+    return timestamp;
+}
+
+/// @returns the file path of the font cache, or an empty path if there is no place to keep it.
+static filesystem::path defaultFontCacheFilePath()
+{
+    if (char const* cacheHome = getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome)
+        return filesystem::path{cacheHome} / "contour" / "fonts";
+    else if (char const* home = getenv("HOME"); home && *home)
+        return filesystem::path{home} / ".cache" / "contour" / "fonts";
+    else
+        return {};
+}
+#endif
+
+/// @returns file paths of the fonts matching the given pattern, the best match first,
+///          followed by the fonts to fall back to.
+static vector<string> getFontFilePaths([[maybe_unused]] string const& _fontPattern)
 {
     if (endsWidthIgnoreCase(_fontPattern, ".ttf") || endsWidthIgnoreCase(_fontPattern, ".otf"))
-        return _fontPattern;
+        return {_fontPattern};
 
     #if defined(HAVE_FONTCONFIG)
+    TRACE_SCOPE("FontManager.getFontFilePaths");
+
     string const pattern = _fontPattern; // TODO: append bold/italic if needed
 
-    FcConfig* fcConfig = FcInitLoadConfigAndFonts();
+    FcConfig* fcConfig = sharedFcConfig();
     FcPattern* fcPattern = FcNameParse((FcChar8 const*) pattern.c_str());
 
     FcDefaultSubstitute(fcPattern);
     FcConfigSubstitute(fcConfig, fcPattern, FcMatchPattern);
 
+    auto paths = vector<string>{};
+
     FcResult fcResult;
     FcPattern* matchedPattern = FcFontMatch(fcConfig, fcPattern, &fcResult);
-    auto path = string{};
     if (fcResult == FcResultMatch && matchedPattern)
     {
         char* resultPath{};
         if (FcPatternGetString(matchedPattern, FC_FILE, 0, (FcChar8**) &resultPath) == FcResultMatch)
-            path = string{resultPath};
+            paths.emplace_back(resultPath);
+    }
+    if (matchedPattern)
         FcPatternDestroy(matchedPattern);
+
+    if (paths.empty())
+        paths.emplace_back(); // no match, leave it to FreeType to fail loading
+
+    // Trimming drops fonts that do not add any coverage over the fonts sorted before them.
+    if (FcFontSet* fontSet = FcFontSort(fcConfig, fcPattern, FcTrue, nullptr, &fcResult); fontSet)
+    {
+        for (int i = 0; i < fontSet->nfont && paths.size() <= MaxFallbackFonts; ++i)
+        {
+            char* path{};
+            if (FcPatternGetString(fontSet->fonts[i], FC_FILE, 0, (FcChar8**) &path) == FcResultMatch)
+                if (find(begin(paths), end(paths), path) == end(paths))
+                    paths.emplace_back(path);
+        }
+        FcFontSetDestroy(fontSet);
     }
+
     FcPatternDestroy(fcPattern);
-    FcConfigDestroy(fcConfig);
-    return path;
+    return paths;
     #endif
 
     #if defined(_WIN32)
@@ -85,17 +191,40 @@ static string getFontFilePath([[maybe_unused]] string const& _fontPattern)
     // This is pretty damn hard coded, and to be properly implemented once the other font related code's done,
     // *OR* being completely deleted when FontConfig's windows build fix released and available via vcpkg.
     if (_fontPattern.find("bold italic") != string::npos)
-        return "C:\\Windows\\Fonts\\consolaz.ttf";
+        return {"C:\\Windows\\Fonts\\consolaz.ttf"};
     else if (_fontPattern.find("italic") != string::npos)
-        return "C:\\Windows\\Fonts\\consolai.ttf";
+        return {"C:\\Windows\\Fonts\\consolai.ttf"};
     else if (_fontPattern.find("bold") != string::npos)
-        return "C:\\Windows\\Fonts\\consolab.ttf";
+        return {"C:\\Windows\\Fonts\\consolab.ttf"};
     else
-        return "C:\\Windows\\Fonts\\consola.ttf";
+        return {"C:\\Windows\\Fonts\\consola.ttf"};
     #endif
 }
 
-FontManager::FontManager()
+void FontManager::preload()
+{
+    #if defined(HAVE_FONTCONFIG)
+    sharedFcConfigFuture();
+    #endif
+}
+
+FontManager::FontManager() :
+    FontManager{
+        #if defined(HAVE_FONTCONFIG)
+        defaultFontCacheFilePath()
+        #else
+        filesystem::path{}
+        #endif
+    }
+{
+}
+
+FontManager::FontManager(filesystem::path _cacheFilePath) :
+    ft_{},
+    fonts_{},
+    cacheFilePath_{ move(_cacheFilePath) },
+    cachedFilePaths_{},
+    cacheLoaded_{ false }
 {
     if (FT_Init_FreeType(&ft_))
         throw runtime_error{ "Failed to initialize FreeType." };
@@ -109,14 +238,109 @@ FontManager::~FontManager()
 
 Font& FontManager::load(string const& _fontPattern, unsigned int _fontSize)
 {
-    string const filePath = getFontFilePath(_fontPattern);
+    TRACE_SCOPE("FontManager.load");
+
+    auto filePaths = cachedFontFilePaths(_fontPattern);
+    if (filePaths.empty())
+    {
+        filePaths = getFontFilePaths(_fontPattern);
+        storeFontFilePaths(_fontPattern, filePaths);
+    }
+
+    string const& filePath = filePaths.front();
 
     if (auto i = fonts_.find(filePath); i != fonts_.end())
         return i->second;
 
-    return fonts_.emplace(make_pair(filePath, Font{ ft_, filePath, _fontSize })).first->second;
+    Font& font = fonts_.emplace(make_pair(filePath, Font{ ft_, filePath, _fontSize })).first->second;
+
+    auto fallbacks = vector<string>(next(begin(filePaths)), end(filePaths));
+    fallbacks.erase(remove(begin(fallbacks), end(fallbacks), filePath), end(fallbacks));
+    if (fallbacks.size() > MaxFallbackFonts)
+        fallbacks.resize(MaxFallbackFonts);
+    font.setFallbacks(move(fallbacks));
+
+    return font;
 }
 
+// {{{ font file path cache
+// The cache file starts with fontconfig's timestamp (see fontconfigTimestamp()) the entries were resolved at,
+// followed by one line per font pattern: the pattern and its font file paths, separated by tabs.
+
+vector<string> FontManager::cachedFontFilePaths(string const& _fontPattern)
+{
+    #if defined(HAVE_FONTCONFIG)
+    if (!cacheLoaded_)
+    {
+        cacheLoaded_ = true;
+        if (!cacheFilePath_.empty())
+        {
+            TRACE_SCOPE("FontManager.loadCache");
+            auto input = ifstream{ cacheFilePath_ };
+            auto line = string{};
+            if (getline(input, line) && line == to_string(fontconfigTimestamp()))
+            {
+                while (getline(input, line))
+                {
+                    auto fields = vector<string>{};
+                    for (size_t first = 0, last = 0; last != string::npos; first = last + 1)
+                    {
+                        last = line.find('\t', first);
+                        fields.emplace_back(line.substr(first, last == string::npos ? last : last - first));
+                    }
+                    if (fields.size() >= 2)
+                        cachedFilePaths_[fields[0]] = vector<string>(next(begin(fields)), end(fields));
+                }
+            }
+        }
+    }
+
+    if (auto const i = cachedFilePaths_.find(_fontPattern); i != cachedFilePaths_.end())
+    {
+        // Font files may have been removed without fontconfig's caches being updated yet.
+        auto ec = error_code{};
+        if (filesystem::exists(i->second.front(), ec))
+            return i->second;
+    }
+    #endif
+
+    return {};
+}
+
+void FontManager::storeFontFilePaths(string const& _fontPattern, vector<string> const& _filePaths)
+{
+    #if defined(HAVE_FONTCONFIG)
+    auto const isStorable = [](string const& _text) { return _text.find_first_of("\t\n") == string::npos; };
+
+    if (cacheFilePath_.empty() || _filePaths.empty() || _filePaths.front().empty() || !isStorable(_fontPattern)
+            || !all_of(begin(_filePaths), end(_filePaths), isStorable))
+        return;
+
+    cachedFilePaths_[_fontPattern] = _filePaths;
+
+    // Failing to write the cache only costs startup time next time, so errors are ignored.
+    auto ec = error_code{};
+    filesystem::create_directories(cacheFilePath_.parent_path(), ec);
+
+    auto const tempFilePath = filesystem::path{cacheFilePath_.string() + ".tmp"};
+    {
+        auto output = ofstream{ tempFilePath, ios::trunc };
+        output << fontconfigTimestamp() << '\n';
+        for (auto const& [pattern, filePaths] : cachedFilePaths_)
+        {
+            output << pattern;
+            for (auto const& filePath : filePaths)
+                output << '\t' << filePath;
+            output << '\n';
+        }
+        if (!output.good())
+            return;
+    }
+    filesystem::rename(tempFilePath, cacheFilePath_, ec);
+    #endif
+}
+// }}}
+
 void Font::setFontSize(unsigned int _fontSize)
 {
     auto ec = FT_Set_Pixel_Sizes(face_, 0, static_cast<FT_UInt>(_fontSize));
@@ -125,16 +349,85 @@ void Font::setFontSize(unsigned int _fontSize)
 
     fontSize_ = _fontSize;
     loadGlyphByIndex(0);
+
+    for (Fallback& fallback : fallbacks_)
+        if (fallback.font)
+            fallback.font->setFontSize(_fontSize);
+}
+
+void Font::setFallbacks(vector<string> _filePaths)
+{
+    fallbacks_.clear();
+    for (string& filePath : _filePaths)
+        fallbacks_.emplace_back(Fallback{move(filePath), nullptr});
+
+    bmpResolutions_.clear();
+    supplementaryResolutions_.clear();
+    shapingCache_.clear();
+}
+
+Font& Font::fallback(unsigned _index)
+{
+    if (_index == 0)
+        return *this;
+
+    Fallback& fallback = fallbacks_.at(_index - 1);
+    if (!fallback.font)
+        fallback.font = make_unique<Font>(ft_, fallback.filePath, fontSize_);
+
+    return *fallback.font;
+}
+
+Font::Resolution Font::resolve(char32_t _char)
+{
+    uint32_t* slot = nullptr;
+    if (_char < 0x10000)
+    {
+        if (bmpResolutions_.empty())
+            bmpResolutions_.resize(0x10000);
+        slot = &bmpResolutions_[_char];
+    }
+    else
+        slot = &supplementaryResolutions_[_char];
+
+    if (!*slot)
+    {
+        auto const resolution = resolveUncached(_char);
+        *slot = ((resolution.font + 1) << 24) | (resolution.glyphIndex & 0xFFFFFF);
+    }
+
+    return Resolution{(*slot >> 24) - 1, *slot & 0xFFFFFF};
+}
+
+Font::Resolution Font::resolveUncached(char32_t _char)
+{
+    for (unsigned i = 0; i < fallbackCount(); ++i)
+    {
+        try
+        {
+            if (auto const glyphIndex = FT_Get_Char_Index(fallback(i), _char); glyphIndex)
+                return Resolution{i, glyphIndex};
+        }
+        catch (runtime_error const&)
+        {
+            // Fallback font could not be loaded, skip it.
+        }
+    }
+
+    return Resolution{0, 0};
 }
 
 // -------------------------------------------------------------------------------------------------------
 
 Font::Font(FT_Library _ft, std::string const& _fontPath, unsigned int _fontSize) :
     ft_{ _ft },
+    filePath_{ _fontPath },
     face_{},
     hb_font_{},
     hb_buf_{},
-    fontSize_{ _fontSize }
+    fontSize_{ _fontSize },
+    shapingCache_{ ShapingCacheCapacity },
+    lookupKey_{}
 {
     if (FT_New_Face(ft_, _fontPath.c_str(), 0, &face_))
         throw runtime_error{ "Failed to load font." };
@@ -150,6 +443,8 @@ Font::Font(FT_Library _ft, std::string const& _fontPath, unsigned int _fontSize)
     hb_font_ = hb_ft_font_create_referenced(face_);
     hb_buf_ = hb_buffer_create();
 
+    buildDirectGlyphTable();
+
     loadGlyphByIndex(0);
     // XXX Woot, needed in order to retrieve maxAdvance()'s field,
     // as max_advance metric seems to be broken on at least FiraCode (Regular),
@@ -159,10 +454,18 @@ Font::Font(FT_Library _ft, std::string const& _fontPath, unsigned int _fontSize)
 
 Font::Font(Font&& v) :
     ft_{ v.ft_ },
+    filePath_{ move(v.filePath_) },
     face_{ v.face_ },
     hb_font_{ v.hb_font_ },
     hb_buf_{ v.hb_buf_ },
-    fontSize_{ v.fontSize_ }
+    fontSize_{ v.fontSize_ },
+    shapingCache_{ move(v.shapingCache_) },
+    lookupKey_{ move(v.lookupKey_) },
+    directGlyphs_{ v.directGlyphs_ },
+    direct_{ v.direct_ },
+    fallbacks_{ move(v.fallbacks_) },
+    bmpResolutions_{ move(v.bmpResolutions_) },
+    supplementaryResolutions_{ move(v.supplementaryResolutions_) }
 {
     v.ft_ = nullptr;
     v.face_ = nullptr;
@@ -176,10 +479,18 @@ Font& Font::operator=(Font&& v)
     // TODO: free current resources, if any
 
     ft_ = v.ft_;
+    filePath_ = move(v.filePath_);
     face_ = v.face_;
     hb_font_ = v.hb_font_;
     hb_buf_ = v.hb_buf_;
     fontSize_ = v.fontSize_;
+    shapingCache_ = move(v.shapingCache_);
+    lookupKey_ = move(v.lookupKey_);
+    directGlyphs_ = v.directGlyphs_;
+    direct_ = v.direct_;
+    fallbacks_ = move(v.fallbacks_);
+    bmpResolutions_ = move(v.bmpResolutions_);
+    supplementaryResolutions_ = move(v.supplementaryResolutions_);
 
     v.ft_ = nullptr;
     v.face_ = nullptr;
@@ -209,15 +520,122 @@ void Font::loadGlyphByIndex(unsigned int _glyphIndex)
         throw runtime_error{ string{"Error loading glyph. "} + freetypeErrorString(ec) };
 }
 
+void Font::buildDirectGlyphTable()
+{
+    // GSUB features HarfBuzz applies to horizontal text by default.
+    hb_tag_t const features[] = {
+        HB_TAG('c', 'c', 'm', 'p'),
+        HB_TAG('l', 'o', 'c', 'l'),
+        HB_TAG('r', 'l', 'i', 'g'),
+        HB_TAG('l', 'i', 'g', 'a'),
+        HB_TAG('c', 'l', 'i', 'g'),
+        HB_TAG('c', 'a', 'l', 't'),
+        HB_TAG('r', 'c', 'l', 't'),
+        HB_TAG_NONE
+    };
+
+    hb_face_t* face = hb_font_get_face(hb_font_);
+    hb_set_t* lookups = hb_set_create();
+    hb_set_t* substitutable = hb_set_create();
+
+    // Any glyph that is covered by a lookup's input or context may be substituted,
+    // depending on its neighbors.
+    hb_ot_layout_collect_lookups(face, HB_OT_TAG_GSUB, nullptr, nullptr, features, lookups);
+    for (hb_codepoint_t lookup = HB_SET_VALUE_INVALID; hb_set_next(lookups, &lookup);)
+        hb_ot_layout_lookup_collect_glyphs(face, HB_OT_TAG_GSUB, lookup,
+                                           substitutable, substitutable, substitutable, nullptr);
+
+    direct_.reset();
+    direct_.set(0); // blank cells
+    for (char32_t ch = 0x20; ch < 0x100; ++ch)
+    {
+        if (ch >= 0x7F && ch < 0xA0)
+            continue; // DEL and C1 control codes
+
+        auto const glyphIndex = FT_Get_Char_Index(face_, ch);
+        if (glyphIndex && !hb_set_has(substitutable, glyphIndex))
+        {
+            directGlyphs_[ch] = glyphIndex;
+            direct_.set(ch);
+        }
+    }
+
+    hb_set_destroy(substitutable);
+    hb_set_destroy(lookups);
+}
+
+bool Font::renderDirect(vector<char32_t> const& _chars, vector<Font::GlyphPosition>& _result)
+{
+    for (char32_t const ch : _chars)
+        if (ch >= direct_.size() || !direct_.test(ch))
+            return false;
+
+    // Equivalent to what shaping yields: glyphs are not substituted, offsets are zero,
+    // and the pen advances by one cell per glyph.
+    unsigned int x = 0;
+    for (char32_t const ch : _chars)
+    {
+        _result.emplace_back(GlyphPosition{x, 0, directGlyphs_[ch], 0});
+        x += maxAdvance();
+    }
+
+    return true;
+}
+
 void Font::render(vector<char32_t> const& _chars, vector<Font::GlyphPosition>& _result)
+{
+    if (renderDirect(_chars, _result))
+        return;
+
+    lookupKey_.fontSize = fontSize_;
+    lookupKey_.text.assign(begin(_chars), end(_chars));
+
+    if (auto const cached = shapingCache_.get(lookupKey_); cached)
+    {
+        _result.insert(end(_result), begin(*cached), end(*cached));
+        return;
+    }
+
+    auto const first = _result.size();
+    shape(_chars, _result);
+    shapingCache_.put(lookupKey_, vector<GlyphPosition>(next(begin(_result), first), end(_result)));
+}
+
+void Font::shape(vector<char32_t> const& _chars, vector<Font::GlyphPosition>& _result)
+{
+    if (_chars.empty())
+        return;
+
+    // Blank cells continue the current run rather than splitting it.
+    auto const fontOf = [this](char32_t _char, unsigned _current) {
+        return _char ? resolve(_char).font : _current;
+    };
+
+    auto const advance = maxAdvance();
+    size_t start = 0;
+    unsigned runFont = fontOf(_chars[0], 0);
+    for (size_t i = 1; i <= _chars.size(); ++i)
+    {
+        unsigned nextFont = runFont;
+        if (i < _chars.size() && (nextFont = fontOf(_chars[i], runFont)) == runFont)
+            continue;
+
+        fallback(runFont).shapeRun(&_chars[start], i - start, start * advance, advance, runFont, _result);
+        start = i;
+        runFont = nextFont;
+    }
+}
+
+void Font::shapeRun(char32_t const* _chars, size_t _count, unsigned _x, unsigned _advance, unsigned _fontIndex,
+                    vector<GlyphPosition>& _result)
 {
     hb_buffer_clear_contents(hb_buf_);
     hb_buffer_add_utf32(
         hb_buf_,
-        reinterpret_cast<uint32_t const*>(_chars.data()),
-        static_cast<int>(_chars.size()),
+        reinterpret_cast<uint32_t const*>(_chars),
+        static_cast<int>(_count),
         0,
-        static_cast<int>(_chars.size())
+        static_cast<int>(_count)
     );
     hb_buffer_set_direction(hb_buf_, HB_DIRECTION_LTR);
     hb_buffer_guess_segment_properties(hb_buf_);
@@ -228,19 +646,18 @@ void Font::render(vector<char32_t> const& _chars, vector<Font::GlyphPosition>& _
     hb_glyph_info_t* info = hb_buffer_get_glyph_infos(hb_buf_, nullptr);
     hb_glyph_position_t* pos = hb_buffer_get_glyph_positions(hb_buf_, nullptr);
 
-    unsigned int cx = 0;
+    unsigned int cx = _x;
     unsigned int cy = 0;
-    unsigned int advance = 0; // not yet exposed nor needed on caller side
     for (unsigned i = 0; i < len; ++i)
     {
         _result.emplace_back(GlyphPosition{
             cx + (pos[i].x_offset >> 6),
             cy + (pos[i].y_offset >> 6),
-            info[i].codepoint
+            info[i].codepoint,
+            _fontIndex
         });
 
-        cx += maxAdvance(), // Ought to be (pos[i].x_advance / 64), but that breaks on some font sizes it seems.
+        cx += _advance; // Ought to be (pos[i].x_advance / 64), but that breaks on some font sizes it seems.
         cy += pos[i].y_advance >> 6;
-        advance += pos[i].x_advance >> 6;
     }
 }
@@ -24,8 +24,14 @@
 
 #include <harfbuzz/hb.h>
 #include <harfbuzz/hb-ft.h>
+#include <harfbuzz/hb-ot.h>
+
+#include <terminal/LRUCache.h>
 
 #include <array>
+#include <bitset>
+#include <filesystem>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -57,6 +63,8 @@ class Font {
     Font& operator=(Font&&);
     ~Font();
 
+    std::string const& filePath() const noexcept { return filePath_; }
+
     unsigned int fontSize() const noexcept { return fontSize_; }
 
     void setFontSize(unsigned int _fontSize);
@@ -89,36 +97,146 @@ class Font {
 
     operator FT_Face () noexcept { return face_; }
 
+    /// Sets the fonts to fall back to, in order, for characters this font does not contain.
+    ///
+    /// Fallback fonts are loaded on first use.
+    void setFallbacks(std::vector<std::string> _filePaths);
+
+    /// @returns the font at the given position in the fallback chain, 0 being this font.
+    Font& fallback(unsigned _index);
+
+    /// Number of fonts in the fallback chain, including this font.
+    size_t fallbackCount() const noexcept { return 1 + fallbacks_.size(); }
+
+    /// Font and glyph a character is rendered with.
+    struct Resolution {
+        unsigned font;       //!< index into the fallback chain, 0 being this font
+        unsigned glyphIndex; //!< glyph of that font, 0 if no font of the chain contains the character
+    };
+
+    /// Finds the first font of the fallback chain that contains the given character.
+    ///
+    /// Results are cached, costing a single table lookup for every character seen before.
+    Resolution resolve(char32_t _char);
+
     struct GlyphPosition {
         unsigned int x;
         unsigned int y;
         unsigned int codepoint;
+        unsigned int font; // index into the fallback chain, 0 being this font
     };
-    /// Renders text into glyph positions of this font.
+    /// Renders text into glyph positions of this font and its fallbacks.
+    ///
+    /// Runs of ASCII and Latin-1 text that cannot be affected by glyph substitutions bypass shaping.
+    /// Other results are cached by font size and text, so that unchanged text is shaped only once.
     void render(std::vector<char32_t> const& _chars, std::vector<GlyphPosition>& _result);
 
+    struct ShapingKey {
+        unsigned int fontSize;
+        std::u32string text;
+
+        bool operator==(ShapingKey const& _other) const noexcept
+        {
+            return fontSize == _other.fontSize && text == _other.text;
+        }
+    };
+
+    struct ShapingKeyHash {
+        size_t operator()(ShapingKey const& _key) const noexcept
+        {
+            return std::hash<std::u32string>{}(_key.text) * 31 + _key.fontSize;
+        }
+    };
+
+    using ShapingCache = terminal::LRUCache<ShapingKey, std::vector<GlyphPosition>, ShapingKeyHash>;
+
+    /// Cache of shaping results, along with its hit/miss counters.
+    ShapingCache const& shapingCache() const noexcept { return shapingCache_; }
+
+  private:
+    /// Shapes text, split into runs of characters that resolve to the same font of the fallback chain.
+    void shape(std::vector<char32_t> const& _chars, std::vector<GlyphPosition>& _result);
+
+    /// Shapes a run of characters with this font, starting at pen position @p _x
+    /// and advancing by @p _advance per glyph.
+    void shapeRun(char32_t const* _chars, size_t _count, unsigned _x, unsigned _advance, unsigned _fontIndex,
+                  std::vector<GlyphPosition>& _result);
+
+    Resolution resolveUncached(char32_t _char);
+
+    /// Renders text without shaping if possible, see directGlyphs_.
+    ///
+    /// @retval true text was rendered into @p _result.
+    /// @retval false text contains characters that require shaping, @p _result is left untouched.
+    bool renderDirect(std::vector<char32_t> const& _chars, std::vector<GlyphPosition>& _result);
+
+    /// Fills directGlyphs_ from the font's character map and GSUB coverage.
+    void buildDirectGlyphTable();
+
   private:
     FT_Library ft_;
+    std::string filePath_;
     FT_Face face_;
     hb_font_t* hb_font_;
     hb_buffer_t* hb_buf_;
     unsigned int fontSize_;
+    ShapingCache shapingCache_;
+    ShapingKey lookupKey_; // reused for lookups, avoiding an allocation per shaped text run
+
+    /// Glyph indices of ASCII and Latin-1 codepoints, used instead of shaping runs that only consist of
+    /// codepoints whose glyphs cannot take part in any glyph substitution (such as ligatures).
+    std::array<unsigned int, 256> directGlyphs_{};
+    std::bitset<256> direct_{};
+
+    struct Fallback {
+        std::string filePath;
+        std::unique_ptr<Font> font; // loaded on first use
+    };
+    std::vector<Fallback> fallbacks_;
+
+    /// Cached resolutions, packed as ((font + 1) << 24 | glyph index), 0 meaning not yet resolved.
+    std::vector<uint32_t> bmpResolutions_;                          // indexed by codepoint
+    std::unordered_map<char32_t, uint32_t> supplementaryResolutions_; // codepoints above U+FFFF
 };
 
 /// API for managing multiple fonts.
+///
+/// Font file paths resolved for a font pattern are cached on disk across runs,
+/// sparing fontconfig altogether on startup as long as no fonts were installed or removed.
 class FontManager {
   public:
+    /// Starts loading fontconfig's configuration in the background, ahead of the first load().
+    ///
+    /// Meant to be called as early as possible on startup.
+    static void preload();
+
+    /// Constructs a font manager caching font file paths in the user's cache directory.
     FontManager();
+
+    /// Constructs a font manager caching font file paths in the given file, none if empty.
+    explicit FontManager(std::filesystem::path _cacheFilePath);
     FontManager(FontManager&&) = delete;
     FontManager(FontManager const&) = delete;
     FontManager& operator=(FontManager&&) = delete;
     FontManager& operator=(FontManager const&) = delete;
     ~FontManager();
 
+    /// Loads the font best matching the given pattern, such as a comma-separated list of families.
+    ///
+    /// The remaining fonts matching the pattern, as sorted by fontconfig, become its fallback chain.
     Font& load(std::string const& _fontPattern, unsigned int _fontSize);
 
+  private:
+    /// @returns cached file paths of the fonts matching the given pattern, or an empty vector if unknown.
+    std::vector<std::string> cachedFontFilePaths(std::string const& _fontPattern);
+    void storeFontFilePaths(std::string const& _fontPattern, std::vector<std::string> const& _filePaths);
+
   private:
     FT_Library ft_;
     std::unordered_map<std::string, Font> fonts_;
+
+    std::filesystem::path cacheFilePath_;
+    std::unordered_map<std::string, std::vector<std::string>> cachedFilePaths_;
+    bool cacheLoaded_;
 };
 
@@ -24,17 +24,29 @@
 using namespace std;
 using namespace terminal;
 
-GLLogger::GLLogger(LogMask _logMask, std::filesystem::path _logfile) :
+GLLogger::GLLogger(LogMask _logMask, LogFormat _format, std::filesystem::path _logfile) :
     logMask_{ _logMask },
-    ownedSink_{ make_unique<ofstream>(_logfile.string(), ios::trunc) },
-    sink_{ ownedSink_.get() }
+    ownedSink_{},
+    sink_{ nullptr },
+    binarySink_{}
 {
+    switch (_format)
+    {
+        case LogFormat::Text:
+            ownedSink_ = make_unique<ofstream>(_logfile.string(), ios::trunc);
+            sink_ = ownedSink_.get();
+            break;
+        case LogFormat::Binary:
+            binarySink_ = make_unique<BinaryLogWriter>(_logfile.string());
+            break;
+    }
 }
 
 GLLogger::GLLogger(LogMask _logMask, std::ostream* _sink) :
     logMask_{ _logMask },
     ownedSink_{},
-    sink_{ _sink }
+    sink_{ _sink },
+    binarySink_{}
 {
 }
 
@@ -79,12 +91,34 @@ void GLLogger::log(LogEvent const& _event)
         _event
     );
 
-    if ((logMask_ & m) != LogMask::None)
+    if ((logMask_ & m) == LogMask::None)
+        return;
+
+    if (binarySink_)
+        binarySink_->write(_event);
+    else if (sink_)
         *sink_ << fmt::format("{}\n", _event);
 }
 
+void GLLogger::log(vector<Command> const& _commands)
+{
+    if ((logMask_ & LogMask::TraceOutput) == LogMask::None)
+        return;
+
+    if (binarySink_)
+        binarySink_->write(_commands);
+    else if (sink_)
+    {
+        log(TraceOutputEvent{ fmt::format("onScreenUpdate: {} instructions", _commands.size()) });
+        for (auto const& mnemonic : to_mnemonic(_commands, true, true))
+            log(TraceOutputEvent{ mnemonic });
+    }
+}
+
 void GLLogger::flush()
 {
-    if (sink_)
+    if (binarySink_)
+        binarySink_->flush();
+    else if (sink_)
         sink_->flush();
 }
@@ -13,6 +13,7 @@
  */
 #pragma once
 
+#include <terminal/BinaryLog.h>
 #include <terminal/InputGenerator.h>
 #include <terminal/Logger.h>
 
@@ -20,6 +21,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 enum class LogMask {
     None  = 0,
@@ -65,10 +67,19 @@ constexpr bool operator!=(LogMask lhs, unsigned rhs) noexcept
     return static_cast<unsigned>(lhs) != rhs;
 }
 
+/// On-disk representation of the log file.
+enum class LogFormat {
+    /// Human readable, one formatted line per event.
+    Text,
+    /// Compact binary records, written asynchronously. Use binlog_decode to read them.
+    Binary,
+};
+
 /// glterm Logging endpoint.
 class GLLogger {
   public:
-    GLLogger(LogMask _mask, std::filesystem::path _logfile);
+    GLLogger(LogMask _mask, LogFormat _format, std::filesystem::path _logfile);
+    GLLogger(LogMask _mask, std::filesystem::path _logfile) : GLLogger{_mask, LogFormat::Text, std::move(_logfile)} {}
     GLLogger(LogMask _mask, std::ostream* _sink);
     GLLogger() : GLLogger{LogMask::ParserError | LogMask::InvalidOutput | LogMask::UnsupportedOutput, nullptr} {}
     GLLogger(GLLogger const&) = delete;
@@ -83,6 +94,12 @@ class GLLogger {
     void log(terminal::LogEvent const& _event);
     void operator()(terminal::LogEvent const& _event) { log(_event); }
 
+    /// Logs the commands of a screen update as trace output.
+    ///
+    /// Into a binary log, the commands are written as they are and formatted by binlog_decode,
+    /// so that tracing costs the screen update thread no formatting.
+    void log(std::vector<terminal::Command> const& _commands);
+
     std::ostream* sink() noexcept { return sink_; }
 
     // debugging endpoints
@@ -95,4 +112,5 @@ class GLLogger {
     LogMask logMask_;
     std::unique_ptr<std::ostream> ownedSink_;
     std::ostream* sink_;
+    std::unique_ptr<terminal::BinaryLogWriter> binarySink_;
 };
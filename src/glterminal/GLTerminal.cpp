@@ -15,11 +15,13 @@
 #include <glterminal/GLLogger.h>
 #include <glterminal/FontManager.h>
 
+#include <terminal/Tracer.h>
 #include <terminal/Util.h>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <utility>
@@ -28,16 +30,8 @@ using namespace std;
 using namespace std::placeholders;
 using namespace terminal;
 
-auto const envvars = terminal::Process::Environment{
-    {"TERM", "xterm-256color"},
-    {"COLORTERM", "xterm"},
-    {"COLORFGBG", "15;0"},
-    {"LINES", ""},
-    {"COLUMNS", ""},
-    {"TERMCAP", ""}
-};
-
-GLTerminal::GLTerminal(WindowSize const& _winSize,
+GLTerminal::GLTerminal(Terminal& _terminal,
+                       Process& _process,
                        unsigned _width,
                        unsigned _height,
                        Font& _regularFont,
@@ -45,22 +39,23 @@ GLTerminal::GLTerminal(WindowSize const& _winSize,
                        glm::vec3 const& _cursorColor,
                        terminal::ColorProfile const& _colorProfile,
                        terminal::Opacity _backgroundOpacity,
-                       string const& _shell,
                        glm::mat4 const& _projectionMatrix,
                        function<void()> _onScreenUpdate,
                        GLLogger& _logger) :
     logger_{ _logger },
     updated_{ false },
     colorProfile_{ _colorProfile },
+    colors_{ _colorProfile },
     backgroundOpacity_{ _backgroundOpacity },
     regularFont_{ _regularFont },
-    textShaper_{ regularFont_.get(), _projectionMatrix },
-    cellBackground_{
-        glm::vec2{
+    textShaper_{ regularFont_.get() },
+    shapedGlyphs_{},
+    cellGrid_{
+        _terminal.size(),
+        glm::ivec2{
             regularFont_.get().maxAdvance(),
             regularFont_.get().lineHeight()
-        },
-        _projectionMatrix
+        }
     },
     cursor_{
         glm::ivec2{
@@ -71,17 +66,22 @@ GLTerminal::GLTerminal(WindowSize const& _winSize,
         _cursorShape,
         _cursorColor
     },
-    terminal_{
-        _winSize,
-        [this](terminal::LogEvent const& _event) { logger_(_event); },
-        bind(&GLTerminal::onScreenUpdateHook, this, _1),
-    },
-    process_{ terminal_, _shell, {_shell}, envvars },
-    processExitWatcher_{ [this]() { wait(); }},
-    onScreenUpdate_{ move(_onScreenUpdate) }
+    terminal_{ _terminal },
+    process_{ _process },
+    cursorBlink_{},
+    onScreenUpdate_{ move(_onScreenUpdate) },
+    processExitWatcher_{ [this]() {
+        wait();
+        // wakes up the event loop for noticing
+        if (onScreenUpdate_)
+            onScreenUpdate_();
+    }}
 {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Prepare for the first frame.
+    textShaper_.prerasterize(regularFont_.get().fontSize());
 }
 
 GLTerminal::~GLTerminal()
@@ -98,12 +98,14 @@ bool GLTerminal::alive() const
 bool GLTerminal::send(char32_t _characterEvent, terminal::Modifier _modifier)
 {
     logger_.keyPress(_characterEvent, _modifier);
+    showCursor();
     return terminal_.send(_characterEvent, _modifier);
 }
 
 bool GLTerminal::send(terminal::Key _key, terminal::Modifier _modifier)
 {
     logger_.keyPress(_key, _modifier);
+    showCursor();
     return terminal_.send(_key, _modifier);
 }
 
@@ -112,7 +114,7 @@ std::string GLTerminal::screenshot() const
     return terminal_.screenshot();
 }
 
-void GLTerminal::resize(unsigned _width, unsigned _height)
+bool GLTerminal::resize(unsigned _width, unsigned _height)
 {
     auto const newSize = terminal::WindowSize{
         static_cast<unsigned short>(_width / regularFont_.get().maxAdvance()),
@@ -136,6 +138,7 @@ void GLTerminal::resize(unsigned _width, unsigned _height)
         terminal_.resize(newSize);
 
     margin_ = computeMargin(newSize, _width, _height);
+    fullRepaint_ = true;
 
     if (doResize)
         cout << fmt::format(
@@ -145,6 +148,8 @@ void GLTerminal::resize(unsigned _width, unsigned _height)
             margin_.left, margin_.bottom,
             regularFont_.get().maxAdvance(), regularFont_.get().lineHeight()
         );
+
+    return doResize;
 }
 
 void GLTerminal::setFont(Font& _font)
@@ -162,14 +167,23 @@ bool GLTerminal::setFontSize(unsigned int _fontSize)
 
     regularFont_.get().setFontSize(_fontSize);
     // TODO: other font styles
-    textShaper_.clearGlyphCache();
-    cellBackground_.resize(glm::ivec2{regularFont_.get().maxAdvance(), regularFont_.get().lineHeight()});
+
+    // Glyphs are cached per font size, so the cache stays valid.
+    textShaper_.prerasterize(_fontSize);
+
+    cellGrid_.setCellSize(glm::ivec2{regularFont_.get().maxAdvance(), regularFont_.get().lineHeight()});
     cursor_.resize(glm::ivec2{regularFont_.get().maxAdvance(), regularFont_.get().lineHeight()});
+    fullRepaint_ = true;
     // TODO update margins?
 
     return true;
 }
 
+void GLTerminal::prerasterize(unsigned _fontSize)
+{
+    textShaper_.prerasterize(_fontSize);
+}
+
 bool GLTerminal::setTerminalSize(terminal::WindowSize const& _newSize)
 {
     if (terminal_.size() == _newSize)
@@ -177,13 +191,13 @@ bool GLTerminal::setTerminalSize(terminal::WindowSize const& _newSize)
 
     terminal_.resize(_newSize);
     margin_ = {0, 0};
+    fullRepaint_ = true;
     return true;
 }
 
 void GLTerminal::setProjection(glm::mat4 const& _projectionMatrix)
 {
-    cellBackground_.setProjection(_projectionMatrix);
-    textShaper_.setProjection(_projectionMatrix);
+    fullRepaint_ = true;
     cursor_.setProjection(_projectionMatrix);
 }
 
@@ -200,14 +214,125 @@ bool GLTerminal::shouldRender()
     return true;
 }
 
-void GLTerminal::render()
+void GLTerminal::render(unsigned _bufferAge)
+{
+    TRACE_SCOPE("GLTerminal.render");
+
+    if (cellGrid_.size() != terminal_.size())
+        cellGrid_.resize(terminal_.size());
+
+    textShaper_.beginFrame();
+
+    // Filling the grid may evict atlas pages that were referenced by cells filled earlier
+    // within the same frame, in which case the grid is filled once more.
+    auto const evictionCount = textShaper_.evictionCount();
+    fillCellGrid();
+    if (textShaper_.evictionCount() != evictionCount)
+        fillCellGrid();
+
+    // Lets the grid move its retained image when the screen scrolled, instead of drawing all rows again.
+    auto const linesScrolled = terminal_.linesScrolled();
+    cellGrid_.scrollUp(static_cast<unsigned>(min(linesScrolled - lastLinesScrolled_, uint64_t{terminal_.size().rows})));
+    lastLinesScrolled_ = linesScrolled;
+
+    cellGrid_.setOrigin(glm::ivec2{margin_.left, margin_.bottom});
+    cellGrid_.render(textShaper_.atlas());
+
+    // Glyphs left blank in this frame are being rasterized, schedule a frame to show them.
+    if (textShaper_.hasPendingGlyphs())
+    {
+        updated_.store(true);
+        if (onScreenUpdate_)
+            onScreenUpdate_();
+    }
+
+    auto const cursor = terminal_.cursor();
+    if (cursor.row != lastCursor_.row || cursor.column != lastCursor_.column)
+        cursorBlink_.reset();
+    bool const cursorVisible = cursor.visible && cursorBlink_.visible();
+    auto const damage = trackDamage(CursorState{cursor.row, cursor.column, cursorVisible}, _bufferAge);
+
+    if (!damage)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        cellGrid_.present();
+        if (cursorVisible)
+            cursor_.render(makeCoords(cursor.column, cursor.row));
+        return;
+    }
+
+    // Repairs the back buffer row by row, leaving the rest as it was presented _bufferAge frames ago.
+    auto const rows = terminal_.size().rows;
+    auto const lineHeight = static_cast<GLint>(regularFont_.get().lineHeight());
+    auto const gridWidth = static_cast<GLint>(terminal_.size().columns * regularFont_.get().maxAdvance());
+    glEnable(GL_SCISSOR_TEST);
+    for (size_t row = 0; row < rows;)
+    {
+        if (!(*damage)[row])
+        {
+            ++row;
+            continue;
+        }
+
+        size_t const first = row;
+        while (row < rows && (*damage)[row])
+            ++row;
+
+        glScissor(static_cast<GLint>(margin_.left),
+                  static_cast<GLint>(margin_.bottom + (rows - row) * lineHeight),
+                  gridWidth,
+                  static_cast<GLint>(row - first) * lineHeight);
+        glClear(GL_COLOR_BUFFER_BIT);
+        cellGrid_.present();
+        if (cursorVisible)
+            cursor_.render(makeCoords(cursor.column, cursor.row));
+    }
+    glDisable(GL_SCISSOR_TEST);
+}
+
+optional<vector<bool>> GLTerminal::trackDamage(CursorState const& _cursor, unsigned _bufferAge)
+{
+    auto const rows = static_cast<size_t>(terminal_.size().rows);
+
+    auto damage = cellGrid_.drawnRows();
+    damage.resize(rows);
+    if (_cursor != lastCursor_)
+    {
+        for (auto const& state : {_cursor, lastCursor_})
+            if (state.visible && state.row >= 1 && state.row <= rows)
+                damage[state.row - 1] = true;
+        lastCursor_ = _cursor;
+    }
+
+    if (fullRepaint_ || damageHistory_.empty() || damageHistory_.front().size() != rows)
+    {
+        fullRepaint_ = false;
+        damageHistory_.clear();
+        damage.assign(rows, true);
+    }
+
+    damageHistory_.push_front(damage);
+    if (damageHistory_.size() > MaxBufferAge)
+        damageHistory_.pop_back();
+
+    // Without knowing which frame the back buffer holds, everything is drawn.
+    if (_bufferAge == 0 || _bufferAge > damageHistory_.size())
+        return nullopt;
+
+    for (size_t age = 1; age < _bufferAge; ++age)
+        for (size_t row = 0; row < rows; ++row)
+            if (damageHistory_[age][row])
+                damage[row] = true;
+
+    return damage;
+}
+
+void GLTerminal::fillCellGrid()
 {
     terminal_.render(bind(&GLTerminal::fillCellGroup, this, _1, _2, _3));
     renderCellGroup();
-
-    // TODO: only render when visible
-    if (terminal_.cursor().visible)
-        cursor_.render(makeCoords(terminal_.cursor().column, terminal_.cursor().row));
+    pendingDraw_.lineNumber = 0;
+    pendingDraw_.text.clear();
 }
 
 void GLTerminal::fillCellGroup(terminal::cursor_pos_t _row, terminal::cursor_pos_t _col, terminal::Screen::Cell const& _cell)
@@ -243,30 +368,51 @@ void GLTerminal::renderCellGroup()
         // TODO: update textshaper's shader to blink
     }
 
+    GLuint flags = 0;
     if (pendingDraw_.attributes.styles & CharacterStyleMask::CrossedOut)
-    {
-        // TODO: render centered horizontal bar through the cell rectangle (we could reuse the TextShaper and a Unicode character for that, respecting opacity!)
-    }
+        flags |= CellGridRenderer::CrossedOut;
 
     if (pendingDraw_.attributes.styles & CharacterStyleMask::DoublyUnderlined)
-    {
-        // TODO: render lower-bound horizontal bar through the cell rectangle (we could reuse the TextShaper and a Unicode character for that, respecting opacity!)
-    }
+        flags |= CellGridRenderer::DoublyUnderlined;
     else if (pendingDraw_.attributes.styles & CharacterStyleMask::Underline)
+        flags |= CellGridRenderer::Underline;
+
+    auto const columns = terminal_.size().columns;
+    auto const row = pendingDraw_.lineNumber;
+    if (row == 0 || row > cellGrid_.size().rows)
+        return;
+
+    auto const lastColumn = min<cursor_pos_t>(pendingDraw_.startColumn + pendingDraw_.text.size() - 1, columns);
+    for (cursor_pos_t col = pendingDraw_.startColumn; col <= lastColumn; ++col)
     {
-        // TODO: render lower-bound double-horizontal bar through the cell rectangle (we could reuse the TextShaper and a Unicode character for that, respecting opacity!)
+        CellGridRenderer::Cell& cell = cellGrid_.at(row, col);
+        cell = CellGridRenderer::Cell{};
+        cell.foreground = fgColor;
+        cell.background = bgColor;
+        cell.flags = flags;
     }
 
-    // TODO: stretch background to number of characters instead.
-    for (cursor_pos_t i = 0; i < pendingDraw_.text.size(); ++i)
-        cellBackground_.render(makeCoords(pendingDraw_.startColumn + i, pendingDraw_.lineNumber), bgColor);
+    shapedGlyphs_.clear();
+    textShaper_.shape(pendingDraw_.text, textStyle, shapedGlyphs_);
 
-    textShaper_.render(
-        makeCoords(pendingDraw_.startColumn, pendingDraw_.lineNumber),
-        pendingDraw_.text,
-        fgColor,
-        textStyle
-    );
+    auto const cellWidth = regularFont_.get().maxAdvance();
+    for (GLTextShaper::ShapedGlyph const& glyph : shapedGlyphs_)
+    {
+        auto const col = pendingDraw_.startColumn + glyph.x / cellWidth;
+        if (col > lastColumn)
+            break;
+
+        CellGridRenderer::Cell& cell = cellGrid_.at(row, col);
+        cell.glyphRect = {
+            glyph.rect.x + static_cast<float>(glyph.x % cellWidth),
+            glyph.rect.y,
+            glyph.rect.z,
+            glyph.rect.w
+        };
+        cell.uv = { glyph.region.uv.x, glyph.region.uv.y, glyph.region.uv.z, glyph.region.uv.w };
+        cell.page = glyph.region.page;
+        cell.flags |= CellGridRenderer::HasGlyph;
+    }
 }
 
 glm::ivec2 GLTerminal::makeCoords(cursor_pos_t col, cursor_pos_t row) const
@@ -277,36 +423,29 @@ glm::ivec2 GLTerminal::makeCoords(cursor_pos_t col, cursor_pos_t row) const
     };
 }
 
-std::pair<glm::vec4, glm::vec4> GLTerminal::makeColors(Screen::GraphicsAttributes const& _attributes) const
+std::pair<uint32_t, uint32_t> GLTerminal::makeColors(Screen::GraphicsAttributes const& _attributes) const
 {
-    float const opacity = [=]() {
+    uint8_t const opacity = [=]() -> uint8_t {
         if (_attributes.styles & CharacterStyleMask::Hidden)
-            return 0.0f;
+            return 0x00;
         else if (_attributes.styles & CharacterStyleMask::Faint)
-            return 0.5f;
+            return 0x80;
         else
-            return 1.0f;
+            return 0xFF;
     }();
+    auto const backgroundOpacity = static_cast<uint8_t>(opacity * static_cast<unsigned>(backgroundOpacity_) / 255);
 
-    auto const applyColor = [_attributes, this](Color const& _color, ColorTarget _target, float _opacity) -> glm::vec4
-    {
-        RGBColor const rgb = apply(colorProfile_, _color, _target, _attributes.styles & CharacterStyleMask::Bold);
-        glm::vec4 const rgba{
-            rgb.red / 255.0f,
-            rgb.green / 255.0f,
-            rgb.blue / 255.0f,
-            _opacity
-        };
-        return rgba;
+    bool const bright = _attributes.styles & CharacterStyleMask::Bold;
+    auto const foreground = [&](uint8_t _alpha) {
+        return colors_.resolve(_attributes.foregroundColor, ColorTarget::Foreground, bright, _alpha);
+    };
+    auto const background = [&](uint8_t _alpha) {
+        return colors_.resolve(_attributes.backgroundColor, ColorTarget::Background, bright, _alpha);
     };
-
-    float const backgroundOpacity = static_cast<float>(backgroundOpacity_) / 255.0f;
 
     return (_attributes.styles & CharacterStyleMask::Inverse)
-        ? pair{ applyColor(_attributes.backgroundColor, ColorTarget::Background, opacity * backgroundOpacity),
-                applyColor(_attributes.foregroundColor, ColorTarget::Foreground, opacity) }
-        : pair{ applyColor(_attributes.foregroundColor, ColorTarget::Foreground, opacity),
-                applyColor(_attributes.backgroundColor, ColorTarget::Background, opacity * backgroundOpacity) };
+        ? pair{ background(backgroundOpacity), foreground(opacity) }
+        : pair{ foreground(opacity), background(backgroundOpacity) };
 }
 
 void GLTerminal::wait()
@@ -335,18 +474,53 @@ void GLTerminal::setTabWidth(unsigned int _tabWidth)
     terminal_.setTabWidth(_tabWidth);
 }
 
+void GLTerminal::setAlternateScreenTimeout(chrono::steady_clock::duration _timeout)
+{
+    terminal_.setAlternateScreenTimeout(_timeout);
+}
+
+void GLTerminal::setColorProfile(terminal::ColorProfile const& _colorProfile)
+{
+    colorProfile_ = _colorProfile;
+    colors_ = PackedColorTable{ _colorProfile };
+    fullRepaint_ = true;
+}
+
+void GLTerminal::setCursorShape(CursorShape _shape)
+{
+    cursor_.setShape(_shape);
+    fullRepaint_ = true;
+    updated_.store(true);
+}
+
+void GLTerminal::setCursorBlinking(bool _enabled)
+{
+    cursorBlink_.setEnabled(_enabled);
+    updated_.store(true);
+}
+
+void GLTerminal::setFocused(bool _focused)
+{
+    cursorBlink_.setFocused(_focused);
+    updated_.store(true);
+}
+
+void GLTerminal::showCursor()
+{
+    if (!cursorBlink_.visible())
+        updated_.store(true);
+    cursorBlink_.reset();
+}
+
 void GLTerminal::setBackgroundOpacity(terminal::Opacity _opacity)
 {
     backgroundOpacity_ = _opacity;
+    fullRepaint_ = true;
 }
 
 void GLTerminal::onScreenUpdateHook(std::vector<terminal::Command> const& _commands)
 {
-    logger_(TraceOutputEvent{ fmt::format("onScreenUpdate: {} instructions", _commands.size()) });
-
-    auto const mnemonics = to_mnemonic(_commands, true, true);
-    for (auto const& mnemonic : mnemonics)
-        logger_(TraceOutputEvent{ mnemonic });
+    logger_.log(_commands);
 
     updated_.store(true);
 
@@ -14,16 +14,20 @@
 #pragma once
 
 #include <terminal/Color.h>
+#include <terminal/CursorBlink.h>
 #include <terminal/Process.h>
 #include <terminal/Terminal.h>
 #include <terminal/WindowSize.h>
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <optional>
 #include <string>
 #include <vector>
 
-#include <glterminal/CellBackground.h>
+#include <glterminal/CellGridRenderer.h>
 #include <glterminal/FontManager.h>
 #include <glterminal/GLCursor.h>
 #include <glterminal/GLLogger.h>
@@ -34,16 +38,20 @@
 class Font;
 
 /// OpenGL-Terminal Object.
+///
+/// Renders a terminal and its process, both of which are owned by the caller and may be started well before,
+/// such that the process' startup overlaps with setting up fonts and OpenGL.
+/// Output received in the meantime is held in the terminal's screen buffer and rendered with the first frame.
 class GLTerminal {
   public:
-    GLTerminal(terminal::WindowSize const& _winSize,
+    GLTerminal(terminal::Terminal& _terminal,
+               terminal::Process& _process,
                unsigned _width, unsigned _height,
                Font& _regularFont,
                CursorShape _cursorShape,
                glm::vec3 const& _cursorColor,
                terminal::ColorProfile const& _colorProfile,
                terminal::Opacity _backgroundOpacity,
-               std::string const& _shell,
                glm::mat4 const& _projectionMatrix,
                std::function<void()> _onScreenUpdate,
                GLLogger& _logger);
@@ -61,17 +69,25 @@ class GLTerminal {
     /// Takes a screenshot of the current screen buffer in VT sequence format.
     std::string screenshot() const;
 
+    /// Keypress-to-screen latency measurements of the underlying terminal.
+    terminal::InputLatency& inputLatency() noexcept { return terminal_.inputLatency(); }
+
     /// Resizes the terminal view to the given number of pixels.
     ///
     /// It also computes the appropricate number of text lines and character columns
     /// and resizes the internal screen buffer as well as informs the connected
     /// PTY slave about the window resize event.
-    void resize(unsigned _width, unsigned _height);
+    ///
+    /// @returns whether the number of lines or columns changed.
+    bool resize(unsigned _width, unsigned _height);
 
     Font const& regularFont() const noexcept { return regularFont_.get(); }
 
     void setFont(Font& _font);
     bool setFontSize(unsigned int _fontSize);
+
+    /// Rasterizes the most common glyphs at the given pixel size in the background, ahead of zooming to it.
+    void prerasterize(unsigned _fontSize);
     bool setTerminalSize(terminal::WindowSize const& _newSize);
 
     /// Sets the projection matrix used for translating rendering coordinates.
@@ -81,8 +97,11 @@ class GLTerminal {
     /// and if so, clears the dirty bit and returns true, false otherwise.
     bool shouldRender();
 
-    /// Renders the screen buffer to the current OpenGL screen.
-    void render();
+    /// Renders the screen buffer to the current OpenGL screen, clearing it with the current clear color.
+    ///
+    /// @param _bufferAge number of frames since the back buffer's contents were presented,
+    ///                   or 0 if unknown. If known, only rows changed since then are drawn.
+    void render(unsigned _bufferAge = 0);
 
     /// Checks if there is still a slave connected to the PTY.
     bool alive() const;
@@ -92,23 +111,64 @@ class GLTerminal {
     /// The alive() test will fail after this call.
     void wait();
 
-    terminal::ColorProfile const& colorProfile() const noexcept { return colorProfile_; }
+    terminal::ColorProfile const& colorProfile() const noexcept { return colorProfile_.get(); }
+
+    /// Sets the color profile to render with. To be called again whenever the profile was modified.
+    void setColorProfile(terminal::ColorProfile const& _colorProfile);
     void setTabWidth(unsigned int _tabWidth);
+    void setAlternateScreenTimeout(std::chrono::steady_clock::duration _timeout);
     void setBackgroundOpacity(terminal::Opacity _opacity);
 
+    void setCursorShape(CursorShape _shape);
+    void setCursorBlinking(bool _enabled);
+
+    /// Suspends cursor blinking while the window is not focused.
+    void setFocused(bool _focused);
+    bool focused() const noexcept { return cursorBlink_.focused(); }
+
+    /// @returns the time the view needs to be rendered again at for blinking the cursor,
+    ///          or nothing if it does not change without further events.
+    std::optional<std::chrono::steady_clock::time_point> nextCursorBlink() const { return cursorBlink_.nextChange(); }
+
+    /// To be invoked by the terminal's screen update hook, marking the view for being rendered again.
+    void onScreenUpdateHook(std::vector<terminal::Command> const& _commands);
+
   private:
     using cursor_pos_t = terminal::cursor_pos_t;
     using RGBColor = terminal::RGBColor;
     using GraphicsAttributes = terminal::Screen::GraphicsAttributes;
     using Cell = terminal::Screen::Cell;
 
-    /// Renders and then clears current cell group if current @p _cell cannot be appended, or appends to current cell group otherwise.
+    /// Fills the grid's cells of the current cell group if current @p _cell cannot be appended, or appends to current cell group otherwise.
     void fillCellGroup(cursor_pos_t _row, cursor_pos_t _col, Cell const& _cell);
     void renderCellGroup();
-    void onScreenUpdateHook(std::vector<terminal::Command> const& _commands);
+
+    /// Shows the cursor right away and restarts its blinking, such as after a key press.
+    void showCursor();
+
+    /// Fills the cell grid with the current screen contents.
+    void fillCellGrid();
+
+    struct CursorState {
+        cursor_pos_t row{};
+        cursor_pos_t column{};
+        bool visible{};
+
+        bool operator!=(CursorState const& _other) const noexcept
+        {
+            return row != _other.row || column != _other.column || visible != _other.visible;
+        }
+    };
+
+    /// Records the rows changed by the current frame.
+    ///
+    /// @returns the 0-based rows changed within the last @p _bufferAge frames,
+    ///          or nothing if the whole screen must be drawn.
+    std::optional<std::vector<bool>> trackDamage(CursorState const& _cursor, unsigned _bufferAge);
 
     glm::ivec2 makeCoords(cursor_pos_t col, cursor_pos_t row) const;
-    std::pair<glm::vec4, glm::vec4> makeColors(GraphicsAttributes const& _attributes) const;
+    /// @returns foreground and background color, packed by terminal::pack().
+    std::pair<uint32_t, uint32_t> makeColors(GraphicsAttributes const& _attributes) const;
 
   private:
     bool alive_ = true;
@@ -142,17 +202,28 @@ class GLTerminal {
     /// Boolean, indicating whether the terminal's screen buffer contains updates to be rendered.
     std::atomic<bool> updated_;
 
-    terminal::ColorProfile const& colorProfile_;
+    std::reference_wrapper<terminal::ColorProfile const> colorProfile_;
+    terminal::PackedColorTable colors_;
     terminal::Opacity backgroundOpacity_;
 
     std::reference_wrapper<Font> regularFont_;
     GLTextShaper textShaper_;
-    CellBackground cellBackground_;
+    std::vector<GLTextShaper::ShapedGlyph> shapedGlyphs_;
+    CellGridRenderer cellGrid_;
+    uint64_t lastLinesScrolled_ = 0;  // terminal's scroll count as of the last frame
     GLCursor cursor_;
 
-    terminal::Terminal terminal_;
-    terminal::Process process_;
-    std::thread processExitWatcher_;
+    /// Maximum back buffer age to redraw changed rows only for. Older buffers are drawn from scratch.
+    static constexpr size_t MaxBufferAge = 4;
+
+    std::deque<std::vector<bool>> damageHistory_; // rows changed by each of the last frames, most recent first
+    CursorState lastCursor_{};
+    bool fullRepaint_ = true;                     // whether or not to draw everything with the next frame
+
+    terminal::Terminal& terminal_;
+    terminal::Process& process_;
+    terminal::CursorBlink cursorBlink_;
 
     std::function<void()> onScreenUpdate_;
+    std::thread processExitWatcher_;
 };
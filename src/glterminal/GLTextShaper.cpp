@@ -12,200 +12,362 @@
  * limitations under the License.
  */
 #include <glterminal/GLTextShaper.h>
+#include <glterminal/DiskCache.h>
 #include <glterminal/FontManager.h>
 
+#include <terminal/Tracer.h>
+
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
 using namespace std;
 
-GLTextShaper::Glyph::~Glyph()
-{
-    // TODO: release texture
+namespace {
+    /// Preferred atlas texture size, clamped to what the GPU supports.
+    constexpr unsigned AtlasPageSize = 2048;
+
+    /// Category of DiskCache entries holding prerasterized glyphs.
+    constexpr auto GlyphCacheCategory = "glyphs";
+
+    /// Version of the glyph cache entry format, to be bumped whenever it changes.
+    constexpr uint32_t GlyphCacheVersion = 2;
+
+    /// @returns a key identifying the glyphs of the given font file prerasterized at the given pixel size.
+    ///
+    /// The display's DPI is accounted for by the pixel size already.
+    uint64_t glyphCacheKey(string const& _fontPath, unsigned _fontSize)
+    {
+        auto ec = error_code{};
+        auto const fileSize = filesystem::file_size(_fontPath, ec);
+        auto const lastWriteTime = filesystem::last_write_time(_fontPath, ec);
+        if (ec)
+            return 0;
+
+        auto key = DiskCache::hash(_fontPath);
+        key = DiskCache::hash(to_string(fileSize), key);
+        key = DiskCache::hash(to_string(lastWriteTime.time_since_epoch().count()), key);
+        key = DiskCache::hash(to_string(_fontSize), key);
+        key = DiskCache::hash(to_string(GlyphCacheVersion), key);
+        return key;
+    }
+
+    void append(vector<uint8_t>& _output, uint32_t _value)
+    {
+        auto const offset = _output.size();
+        _output.resize(offset + sizeof(_value));
+        memcpy(&_output[offset], &_value, sizeof(_value));
+    }
+
+    bool extract(vector<uint8_t> const& _input, size_t& _offset, uint32_t& _value)
+    {
+        if (_input.size() - _offset < sizeof(_value))
+            return false;
+        memcpy(&_value, &_input[_offset], sizeof(_value));
+        _offset += sizeof(_value);
+        return true;
+    }
+
+    // Entries consist of the format version and number of glyphs, followed by each glyph's
+    // style, index, size, bearing, height, descender, advance and pixels.
+
+    vector<uint8_t> serialize(vector<GlyphRasterizer::Bitmap> const& _bitmaps)
+    {
+        auto output = vector<uint8_t>{};
+        append(output, GlyphCacheVersion);
+        append(output, static_cast<uint32_t>(_bitmaps.size()));
+        for (auto const& bitmap : _bitmaps)
+        {
+            append(output, static_cast<uint32_t>(bitmap.style));
+            append(output, bitmap.glyphIndex);
+            append(output, static_cast<uint32_t>(bitmap.size.x));
+            append(output, static_cast<uint32_t>(bitmap.size.y));
+            append(output, static_cast<uint32_t>(bitmap.bearing.x));
+            append(output, static_cast<uint32_t>(bitmap.bearing.y));
+            append(output, bitmap.height);
+            append(output, bitmap.descender);
+            append(output, bitmap.advance);
+            output.insert(end(output), begin(bitmap.pixels), end(bitmap.pixels));
+        }
+        return output;
+    }
+
+    optional<vector<GlyphRasterizer::Bitmap>> deserialize(vector<uint8_t> const& _input, unsigned _fontSize)
+    {
+        size_t offset = 0;
+        uint32_t version = 0;
+        uint32_t count = 0;
+        if (!extract(_input, offset, version) || version != GlyphCacheVersion || !extract(_input, offset, count))
+            return nullopt;
+
+        auto bitmaps = vector<GlyphRasterizer::Bitmap>{};
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t fields[9];
+            for (uint32_t& field : fields)
+                if (!extract(_input, offset, field))
+                    return nullopt;
+
+            auto const pixelCount = size_t{fields[2]} * fields[3];
+            if (fields[0] > static_cast<uint32_t>(FontStyle::BoldItalic) || _input.size() - offset < pixelCount)
+                return nullopt;
+
+            bitmaps.emplace_back(GlyphRasterizer::Bitmap{
+                0,
+                _fontSize,
+                static_cast<FontStyle>(fields[0]),
+                fields[1],
+                glm::ivec2{fields[2], fields[3]},
+                glm::ivec2{static_cast<int32_t>(fields[4]), static_cast<int32_t>(fields[5])},
+                fields[6],
+                fields[7],
+                fields[8],
+                vector<uint8_t>(next(begin(_input), offset), next(begin(_input), offset + pixelCount))
+            });
+            offset += pixelCount;
+        }
+
+        return { move(bitmaps) };
+    }
 }
 
-GLTextShaper::GLTextShaper(Font& _regularFont, glm::mat4 const& _projection) :
+GLTextShaper::GLTextShaper(Font& _regularFont) :
     cache_{},
+    atlas_{ MaxAtlasPages, AtlasPageSize, [this](unsigned _page) { onEvict(_page); } },
     regularFont_{ _regularFont },
-    //projectionMatrix_{ _projection },
-    shader_{ vertexShaderCode(), fragmentShaderCode() },
-    colorLocation_{ shader_.uniformLocation("textColor") }
+    rasterizer_{ make_unique<GlyphRasterizer>() },
+    prerasterizedSizes_{}
 {
     // disable byte-alignment restriction
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+}
 
-    // Configure VAO/VBO for texture quads
-    glGenVertexArrays(1, &vao_);
-    glBindVertexArray(vao_);
+void GLTextShaper::setFont(Font& _regularFont)
+{
+    regularFont_ = _regularFont;
+    rasterizer_ = make_unique<GlyphRasterizer>();
+    clearGlyphCache();
+}
 
-    glGenBuffers(1, &vbo_);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+void GLTextShaper::prerasterize(unsigned _fontSize)
+{
+    if (!_fontSize || find(begin(prerasterizedSizes_), end(prerasterizedSizes_), _fontSize) != end(prerasterizedSizes_))
+        return;
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
+    prerasterizedSizes_.push_back(_fontSize);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    string const& fontPath = regularFont_.get().filePath();
+    uint64_t const cacheKey = DiskCache::enabled() ? glyphCacheKey(fontPath, _fontSize) : 0;
+    if (cacheKey)
+    {
+        TRACE_SCOPE("GLTextShaper.loadCachedGlyphs");
+        if (auto const data = DiskCache::read(GlyphCacheCategory, cacheKey); data)
+        {
+            if (auto const bitmaps = deserialize(*data, _fontSize); bitmaps)
+            {
+                for (auto const& bitmap : *bitmaps)
+                    adopt(bitmap);
+                return;
+            }
+        }
+    }
 
-    setProjection(_projection);
-}
+    auto chars = u32string{};
+    for (char32_t ch = 0x21; ch < 0x7F; ++ch)
+        chars.push_back(ch);
 
-GLTextShaper::~GLTextShaper()
-{
-    // TODO: release vbo / vba
-}
+    for (auto const style : PrerasterizedStyles)
+        rasterizer_->request(fontPath, 0, _fontSize, style, chars);
 
-string const& GLTextShaper::vertexShaderCode()
-{
-	static string const code = R"(
-		#version 140
-        in vec4 vertex;
-		out vec2 TexCoords;
-
-		uniform mat4 projection;
-
-		void main()
-		{
-			gl_Position = projection * vec4(vertex.xy, 0.1, 1.0);
-			TexCoords = vertex.zw;
-		}
-	)";
-	return code;
+    if (cacheKey)
+        prerasterizing_[_fontSize] = Prerasterization{cacheKey, {}, {}};
 }
 
-string const& GLTextShaper::fragmentShaderCode()
+void GLTextShaper::beginFrame()
 {
-	static string const code = R"(
-		#version 140
-		in vec2 TexCoords;
-		out vec4 color;
-
-		uniform sampler2D text;
-		uniform vec4 textColor;
-
-		void main()
-		{
-			vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-			color = textColor * sampled;
-		}
-	)";
-	return code;
+    ++frame_;
+    requestedThisFrame_ = false;
+    adoptRasterized();
+
+    // Forget requests that did not yield a bitmap, or whose glyphs were not needed anymore.
+    for (auto i = pending_.begin(); i != pending_.end();)
+        if (i->second + 1 < frame_)
+            i = pending_.erase(i);
+        else
+            ++i;
 }
 
-void GLTextShaper::setFont(Font& _regularFont)
+void GLTextShaper::adoptRasterized()
 {
-    regularFont_ = _regularFont;
-    clearGlyphCache();
+    if (!rasterizer_->hasResults())
+        return;
+
+    for (GlyphRasterizer::Bitmap& bitmap : rasterizer_->take())
+    {
+        adopt(bitmap);
+
+        // Collect prerasterized glyphs, to be stored in the disk cache once all styles arrived.
+        // Glyphs requested while rendering may be collected along, which is harmless either way.
+        auto const style = find(begin(PrerasterizedStyles), end(PrerasterizedStyles), bitmap.style);
+        if (auto p = prerasterizing_.find(bitmap.fontSize);
+                p != prerasterizing_.end() && bitmap.font == 0 && style != end(PrerasterizedStyles))
+        {
+            Prerasterization& prerasterization = p->second;
+            prerasterization.styles.set(static_cast<size_t>(distance(begin(PrerasterizedStyles), style)));
+            prerasterization.bitmaps.emplace_back(move(bitmap));
+        }
+    }
+
+    for (auto p = prerasterizing_.begin(); p != prerasterizing_.end();)
+        if (p->second.styles.all())
+        {
+            DiskCache::write(GlyphCacheCategory, p->second.cacheKey, serialize(p->second.bitmaps));
+            p = prerasterizing_.erase(p);
+        }
+        else
+            ++p;
 }
 
-void GLTextShaper::setProjection(glm::mat4 const& _projectionMatrix)
+void GLTextShaper::adopt(GlyphRasterizer::Bitmap const& _bitmap)
 {
-	shader_.use();
-	shader_.setMat4("projection", _projectionMatrix);
+    auto const key = makeKey(_bitmap.fontSize, _bitmap.font, _bitmap.style, _bitmap.glyphIndex);
+    pending_.erase(key);
+    if (cache_.find(key) != cache_.end())
+        return;
+
+    auto region = optional<TextureAtlas::Region>{};
+    if (_bitmap.size.x && _bitmap.size.y)
+    {
+        region = atlas_.insert(_bitmap.size.x, _bitmap.size.y, _bitmap.pixels.data());
+        if (!region)
+            return;
+    }
+
+    cache_.emplace(key, Glyph{
+        region,
+        _bitmap.size,
+        _bitmap.bearing,
+        _bitmap.height,
+        _bitmap.descender,
+        _bitmap.advance
+    });
 }
 
-void GLTextShaper::render(
-    glm::ivec2 _pos,
-    std::vector<char32_t> const& _chars,
-    glm::vec4 const& _color,
-    FontStyle _style)
+void GLTextShaper::shape(vector<char32_t> const& _chars, FontStyle _style, vector<ShapedGlyph>& _result)
 {
-    Font& font = regularFont_.get(); // TODO: respect _style
+    TRACE_SCOPE("GLTextShaper.shape");
 
-    font.render(_chars, glyphPositions_);
+    Font& font = regularFont_.get(); // TODO: respect _style
 
-    shader_.use();
-    shader_.setVec4(colorLocation_, _color);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(vao_);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    {
+        TRACE_SCOPE("Font.render");
+        font.render(_chars, glyphPositions_);
+    }
 
     for (auto const& gpos : glyphPositions_)
     {
         if (gpos.codepoint == 0)
             continue;
 
-        Glyph const& glyph = getGlyphByIndex(gpos.codepoint, _style);
-        unsigned const x = _pos.x + gpos.x;
-        unsigned const y = _pos.y + gpos.y;
-
-        auto const xpos = static_cast<GLfloat>(x + glyph.bearing.x);
-        auto const ypos = static_cast<GLfloat>(y + font.baseline() - glyph.descender);
-        auto const w = static_cast<GLfloat>(glyph.size.x);
-        auto const h = static_cast<GLfloat>(glyph.size.y);
-
-        GLfloat const vertices[6][4] = {
-            { xpos,     ypos + h,   0.0, 0.0 },
-            { xpos,     ypos,       0.0, 1.0 },
-            { xpos + w, ypos,       1.0, 1.0 },
-
-            { xpos,     ypos + h,   0.0, 0.0 },
-            { xpos + w, ypos,       1.0, 1.0 },
-            { xpos + w, ypos + h,   1.0, 0.0 }
-        };
-
-        glBindTexture(GL_TEXTURE_2D, glyph.textureID);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+        Glyph const* glyph = getGlyphByIndex(gpos.codepoint, gpos.font, _style);
+        if (!glyph || !glyph->region)
+            continue;
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        atlas_.touch(glyph->region->page);
+        _result.emplace_back(ShapedGlyph{
+            gpos.x,
+            glm::vec4{
+                static_cast<float>(glyph->bearing.x),
+                static_cast<float>(gpos.y + font.baseline() - glyph->descender),
+                static_cast<float>(glyph->size.x),
+                static_cast<float>(glyph->size.y)
+            },
+            *glyph->region
+        });
     }
 
     glyphPositions_.clear();
 
-    #if !defined(NDEBUG)
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    #endif
+    for (unsigned fontIndex = 0; fontIndex < missingGlyphs_.size(); ++fontIndex)
+    {
+        if (missingGlyphs_[fontIndex].empty())
+            continue;
+
+        rasterizer_->request(font.fallback(fontIndex).filePath(), fontIndex, font.fontSize(), _style,
+                             move(missingGlyphs_[fontIndex]));
+        missingGlyphs_[fontIndex].clear();
+        requestedThisFrame_ = true;
+    }
 }
 
-GLTextShaper::Glyph& GLTextShaper::getGlyphByIndex(unsigned long _index, FontStyle _style)
+GLTextShaper::Glyph const* GLTextShaper::getGlyphByIndex(unsigned long _index, unsigned _font, FontStyle _style)
 {
-    auto& cache = cache_[static_cast<size_t>(_style)];
-    if (auto i = cache.find(_index); i != cache.end())
-        return i->second;
+    Font& font = regularFont_.get().fallback(_font); // TODO: respect _style
+
+    auto const key = makeKey(font.fontSize(), _font, _style, _index);
+    if (auto i = cache_.find(key); i != cache_.end())
+        return &i->second;
+
+    // Glyphs not seen before are rasterized in the background and left blank in the current frame.
+    // Should the bitmap not have arrived by the next frame, it is rasterized right away.
+    if (auto const p = pending_.find(key); p == pending_.end())
+    {
+        pending_.emplace(key, frame_);
+        if (missingGlyphs_.size() <= _font)
+            missingGlyphs_.resize(_font + 1);
+        missingGlyphs_[_font].push_back(static_cast<unsigned>(_index));
+        return nullptr;
+    }
+    else if (p->second == frame_)
+        return nullptr;
+    else
+        pending_.erase(p);
 
-    Font& font = regularFont_; // TODO: respect _style
     font.loadGlyphByIndex(_index);
 
-    // Generate texture
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED,
-        font->glyph->bitmap.width,
-        font->glyph->bitmap.rows,
-        0,
-        GL_RED,
-        GL_UNSIGNED_BYTE,
-        font->glyph->bitmap.buffer
-    );
-
-    // Set texture options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    auto const& bitmap = font->glyph->bitmap;
+    auto region = optional<TextureAtlas::Region>{};
+    if (bitmap.width && bitmap.rows)
+        region = atlas_.insert(bitmap.width, bitmap.rows, bitmap.buffer);
 
     // store character for later use
     auto const descender = font->glyph->metrics.height / 64 - font->glyph->bitmap_top;
-    Glyph& glyph = cache.emplace(make_pair(_index, Glyph{
-        texture,
-        glm::ivec2{(unsigned)font->glyph->bitmap.width, (unsigned)font->glyph->bitmap.rows},
+    Glyph& glyph = cache_.emplace(make_pair(key, Glyph{
+        region,
+        glm::ivec2{(unsigned)bitmap.width, (unsigned)bitmap.rows},
         glm::ivec2{(unsigned)font->glyph->bitmap_left, (unsigned)font->glyph->bitmap_top},
         static_cast<unsigned>(font->height) / 64,
         static_cast<unsigned>(descender),
         static_cast<unsigned>(font->glyph->advance.x / 64)
     })).first->second;
 
-    return glyph;
+    return &glyph;
+}
+
+void GLTextShaper::onEvict(unsigned _page)
+{
+    ++evictionCount_;
+
+    for (auto i = cache_.begin(); i != cache_.end();)
+        if (i->second.region && i->second.region->page == _page)
+            i = cache_.erase(i);
+        else
+            ++i;
+
+    // Sizes rasterized in advance may have lost glyphs now.
+    prerasterizedSizes_.clear();
 }
 
 void GLTextShaper::clearGlyphCache()
 {
-    for (auto& cache: cache_)
-        cache.clear();
+    cache_.clear();
+    pending_.clear();
+    prerasterizedSizes_.clear();
+    prerasterizing_.clear();
+
+    atlas_.clear();
+    ++evictionCount_;
 }
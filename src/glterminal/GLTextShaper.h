@@ -14,57 +14,119 @@
 #pragma once
 
 #include <glterminal/FontManager.h>
-#include <glterminal/Shader.h>
+#include <glterminal/GlyphRasterizer.h>
+#include <glterminal/TextureAtlas.h>
 
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 
 #include <array>
+#include <bitset>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
+/**
+ * Shapes text runs into glyphs, rasterized into a shared texture atlas.
+ *
+ * Glyphs are cached per font of the fallback chain and pixel size, so that switching back to a recently used font size
+ * does not rasterize them again. The atlas size bounds the memory used by all cached sizes,
+ * with the least recently used atlas pages being evicted first.
+ */
 class GLTextShaper {
   public:
-    GLTextShaper(Font& _regularFont, glm::mat4 const& _projection);
-    ~GLTextShaper();
+    /// Upper bound of atlas textures to allocate before starting to evict glyphs,
+    /// which amounts to a glyph memory budget of 16 MiB.
+    static constexpr unsigned MaxAtlasPages = 4;
+
+    /// A shaped glyph along with its location in the texture atlas.
+    struct ShapedGlyph {
+        unsigned x;                   //!< pen position in pixels, relative to the start of the text run
+        glm::vec4 rect;               //!< left, bottom, width, height of the bitmap relative to the pen position
+        TextureAtlas::Region region;  //!< location of the bitmap in the atlas
+    };
+
+    explicit GLTextShaper(Font& _regularFont);
 
     void setFont(Font& _regularFont);
-    void setProjection(glm::mat4 const& _projectionMatrix);
 
-    void render(
-        glm::ivec2 _pos,
-        std::vector<char32_t> const& _chars,
-        glm::vec4 const& _color,
-        FontStyle _style);
+    /// Shapes given text and appends the resulting glyphs, that have a bitmap, to @p _result.
+    void shape(std::vector<char32_t> const& _chars, FontStyle _style, std::vector<ShapedGlyph>& _result);
+
+    TextureAtlas const& atlas() const noexcept { return atlas_; }
+
+    /// Number of atlas pages evicted so far.
+    ///
+    /// Any ShapedGlyph obtained before this number changed may refer to overwritten atlas contents.
+    uint64_t evictionCount() const noexcept { return evictionCount_; }
+
+    /// Rasterizes printable ASCII in the regular font style at the given pixel size in the background, such that
+    /// rendering at that size does not need to rasterize the most common glyphs on the render thread.
+    ///
+    /// If a DiskCache is enabled, the resulting glyphs are stored there and loaded right away next time.
+    void prerasterize(unsigned _fontSize);
+
+    /// Prepares for shaping text of a new frame, adopting glyphs that were rasterized in the background.
+    void beginFrame();
+
+    /// Tells whether glyphs were left out of the current frame because they are still being rasterized,
+    /// in which case another frame should be rendered soon.
+    bool hasPendingGlyphs() const noexcept { return requestedThisFrame_; }
 
     void clearGlyphCache();
 
   private:
     struct Glyph {
-        GLuint textureID;
+        std::optional<TextureAtlas::Region> region; // location in the atlas, if the glyph has a bitmap
         glm::ivec2 size;      // glyph size
         glm::ivec2 bearing;   // offset from baseline to left/top of glyph
         unsigned height;
         unsigned descender;
         unsigned advance;     // offset to advance to next glyph in line.
-
-        ~Glyph();
     };
 
-    Glyph& getGlyphByIndex(unsigned long _index, FontStyle _style);
+    static uint64_t makeKey(unsigned _fontSize, unsigned _font, FontStyle _style, unsigned long _index) noexcept
+    {
+        return (uint64_t(_fontSize) << 40) | (uint64_t(_font) << 34) | (uint64_t(_style) << 32) | uint32_t(_index);
+    }
+
+    /// @param _font index into the fallback chain of the regular font.
+    /// @returns the glyph or nullptr if it is being rasterized in the background.
+    Glyph const* getGlyphByIndex(unsigned long _index, unsigned _font, FontStyle _style);
 
-    static std::string const& fragmentShaderCode();
-    static std::string const& vertexShaderCode();
+    /// Moves glyphs rasterized in the background into the atlas.
+    void adoptRasterized();
+    void adopt(GlyphRasterizer::Bitmap const& _bitmap);
+
+    /// Drops all cached glyphs living in the given atlas page, right before it is being reused.
+    void onEvict(unsigned _page);
 
   private:
-    std::array<std::unordered_map<unsigned /*glyph index*/, Glyph>, 4> cache_;
+    std::unordered_map<uint64_t /*font size, font, style, glyph index*/, Glyph> cache_;
+    TextureAtlas atlas_;
+    uint64_t evictionCount_ = 0;
     std::reference_wrapper<Font> regularFont_;
+    std::unique_ptr<GlyphRasterizer> rasterizer_;
+    std::vector<unsigned> prerasterizedSizes_;
+
+    /// Font styles to prerasterize. Only the regular one for now, as the others are not rasterized
+    /// from faces of their own yet, and would merely occupy atlas space with identical bitmaps.
+    static constexpr std::array<FontStyle, 1> PrerasterizedStyles{ FontStyle::Regular };
+
+    /// Glyphs being prerasterized, to be stored in the disk cache.
+    struct Prerasterization {
+        uint64_t cacheKey;
+        std::bitset<PrerasterizedStyles.size()> styles; // PrerasterizedStyles whose glyphs arrived already
+        std::vector<GlyphRasterizer::Bitmap> bitmaps;
+    };
+    std::unordered_map<unsigned /*font size*/, Prerasterization> prerasterizing_;
+
+    uint64_t frame_ = 0;
+    std::unordered_map<uint64_t /*key*/, uint64_t /*frame*/> pending_; // glyphs being rasterized in the background
+    std::vector<std::vector<unsigned>> missingGlyphs_; // per font, glyphs to request rasterizing, collected while shaping
+    bool requestedThisFrame_ = false;
     std::vector<Font::GlyphPosition> glyphPositions_;
-    GLuint vbo_;
-    GLuint vao_;
-    //glm::mat4 projectionMatrix_;
-    Shader shader_;
-    GLint colorLocation_;
 };
-
@@ -0,0 +1,178 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/GlyphRasterizer.h>
+
+#include <terminal/Tracer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+GlyphRasterizer::GlyphRasterizer(unsigned _workerCount)
+{
+    if (!_workerCount)
+        _workerCount = clamp(thread::hardware_concurrency(), 2u, 5u) - 1;
+
+    for (unsigned i = 0; i < _workerCount; ++i)
+    {
+        auto worker = make_unique<Worker>();
+        if (FT_Init_FreeType(&worker->ft))
+        {
+            for (auto& w : workers_)
+                FT_Done_FreeType(w->ft);
+            throw runtime_error{ "Failed to initialize FreeType." };
+        }
+        workers_.emplace_back(move(worker));
+    }
+
+    for (auto& worker : workers_)
+        worker->thread = thread{ [this, w = worker.get()]() { run(*w); } };
+}
+
+GlyphRasterizer::~GlyphRasterizer()
+{
+    {
+        lock_guard<mutex> _l{ lock_ };
+        stop_ = true;
+    }
+    condition_.notify_all();
+
+    for (auto& worker : workers_)
+    {
+        worker->thread.join();
+        for (auto& [path, face] : worker->faces)
+            if (face)
+                FT_Done_Face(face);
+        FT_Done_FreeType(worker->ft);
+    }
+}
+
+void GlyphRasterizer::request(string const& _fontPath, unsigned _font, unsigned _fontSize, FontStyle _style,
+                              u32string _chars)
+{
+    enqueue(Job{_fontPath, _font, _fontSize, _style, move(_chars), {}});
+}
+
+void GlyphRasterizer::request(string const& _fontPath, unsigned _font, unsigned _fontSize, FontStyle _style,
+                              vector<unsigned> _glyphIndices)
+{
+    enqueue(Job{_fontPath, _font, _fontSize, _style, {}, move(_glyphIndices)});
+}
+
+void GlyphRasterizer::enqueue(Job _job)
+{
+    {
+        lock_guard<mutex> _l{ lock_ };
+        jobs_.emplace_back(move(_job));
+    }
+    condition_.notify_one();
+}
+
+FT_Face GlyphRasterizer::openFace(Worker& _worker, string const& _fontPath)
+{
+    if (auto const i = _worker.faces.find(_fontPath); i != _worker.faces.end())
+        return i->second;
+
+    FT_Face face{};
+    if (FT_New_Face(_worker.ft, _fontPath.c_str(), 0, &face) == FT_Err_Ok
+            && FT_Select_Charmap(face, FT_ENCODING_UNICODE) != FT_Err_Ok)
+    {
+        FT_Done_Face(face);
+        face = nullptr;
+    }
+
+    // Failures are remembered as well, not to retry opening the file for every job.
+    _worker.faces.emplace(_fontPath, face);
+    return face;
+}
+
+vector<GlyphRasterizer::Bitmap> GlyphRasterizer::take()
+{
+    auto bitmaps = vector<Bitmap>{};
+    lock_guard<mutex> _l{ lock_ };
+    bitmaps.swap(results_);
+    hasResults_.store(false, memory_order_release);
+    return bitmaps;
+}
+
+void GlyphRasterizer::run(Worker& _worker)
+{
+    terminal::tracing::setThreadName("glyph rasterizer");
+
+    for (;;)
+    {
+        unique_lock<mutex> lock{ lock_ };
+        condition_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (stop_)
+            break;
+
+        auto const job = move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        if (FT_Face face = openFace(_worker, job.fontPath); face)
+            rasterize(face, job);
+    }
+}
+
+void GlyphRasterizer::rasterize(FT_Face _face, Job const& _job)
+{
+    TRACE_SCOPE("GlyphRasterizer.rasterize");
+
+    if (FT_Set_Pixel_Sizes(_face, 0, static_cast<FT_UInt>(_job.fontSize)))
+        return;
+
+    auto glyphIndices = _job.glyphIndices;
+    for (char32_t const ch : _job.chars)
+        if (auto const glyphIndex = FT_Get_Char_Index(_face, ch); glyphIndex)
+            glyphIndices.push_back(glyphIndex);
+
+    auto bitmaps = vector<Bitmap>{};
+    bitmaps.reserve(glyphIndices.size());
+
+    for (unsigned const glyphIndex : glyphIndices)
+    {
+        if (FT_Load_Glyph(_face, glyphIndex, FT_LOAD_RENDER) != FT_Err_Ok)
+            continue;
+
+        auto const& glyph = *_face->glyph;
+        auto const width = glyph.bitmap.width;
+        auto const rows = glyph.bitmap.rows;
+
+        auto bitmap = Bitmap{
+            _job.font,
+            _job.fontSize,
+            _job.style,
+            glyphIndex,
+            glm::ivec2{width, rows},
+            glm::ivec2{glyph.bitmap_left, glyph.bitmap_top},
+            static_cast<unsigned>(_face->height) / 64,
+            static_cast<unsigned>(glyph.metrics.height / 64 - glyph.bitmap_top),
+            static_cast<unsigned>(glyph.advance.x / 64),
+            vector<uint8_t>(width * rows)
+        };
+
+        for (unsigned row = 0; row < rows; ++row)
+            memcpy(&bitmap.pixels[row * width], glyph.bitmap.buffer + row * glyph.bitmap.pitch, width);
+
+        bitmaps.emplace_back(move(bitmap));
+    }
+
+    lock_guard<mutex> _l{ lock_ };
+    for (auto& bitmap : bitmaps)
+        results_.emplace_back(move(bitmap));
+    hasResults_.store(true, memory_order_release);
+}
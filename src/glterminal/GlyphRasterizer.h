@@ -0,0 +1,114 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <glterminal/FontManager.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Pool of worker threads rasterizing glyphs in the background.
+ *
+ * Each worker opens its own FreeType instances of the fonts it is asked to rasterize from,
+ * as FreeType faces must not be used by multiple threads at once.
+ * Resulting bitmaps are handed over to the rendering thread, which uploads them to the GPU.
+ */
+class GlyphRasterizer {
+  public:
+    /// A rasterized glyph, with metrics as expected by GLTextShaper.
+    struct Bitmap {
+        unsigned font;      // caller provided font identifier, as passed to request()
+        unsigned fontSize;
+        FontStyle style;
+        unsigned glyphIndex;
+        glm::ivec2 size;
+        glm::ivec2 bearing;
+        unsigned height;
+        unsigned descender;
+        unsigned advance;
+        std::vector<uint8_t> pixels; // tightly packed, size.x * size.y bytes
+    };
+
+    /// @param _workerCount number of worker threads, or 0 to choose based on the number of CPU cores.
+    ///
+    /// @throws std::runtime_error if FreeType could not be initialized.
+    explicit GlyphRasterizer(unsigned _workerCount = 0);
+    GlyphRasterizer(GlyphRasterizer const&) = delete;
+    GlyphRasterizer& operator=(GlyphRasterizer const&) = delete;
+    ~GlyphRasterizer();
+
+    size_t workerCount() const noexcept { return workers_.size(); }
+
+    /// Enqueues rasterizing the glyphs of given characters at the given pixel size.
+    ///
+    /// @param _fontPath file path of the font to rasterize from.
+    /// @param _font identifier of that font, passed on to resulting bitmaps.
+    void request(std::string const& _fontPath, unsigned _font, unsigned _fontSize, FontStyle _style,
+                 std::u32string _chars);
+
+    /// Enqueues rasterizing the given glyphs at the given pixel size.
+    void request(std::string const& _fontPath, unsigned _font, unsigned _fontSize, FontStyle _style,
+                 std::vector<unsigned> _glyphIndices);
+
+    /// @returns whether take() would return any bitmaps, without locking.
+    bool hasResults() const noexcept { return hasResults_.load(std::memory_order_acquire); }
+
+    /// Takes all bitmaps rasterized so far.
+    std::vector<Bitmap> take();
+
+  private:
+    struct Job {
+        std::string fontPath;
+        unsigned font;
+        unsigned fontSize;
+        FontStyle style;
+        std::u32string chars;               // characters to rasterize the glyphs of
+        std::vector<unsigned> glyphIndices; // glyphs to rasterize
+    };
+
+    struct Worker {
+        FT_Library ft{};
+        std::unordered_map<std::string, FT_Face> faces{}; // opened on first use
+        std::thread thread{};
+    };
+
+    void enqueue(Job _job);
+    void run(Worker& _worker);
+    static FT_Face openFace(Worker& _worker, std::string const& _fontPath);
+    void rasterize(FT_Face _face, Job const& _job);
+
+  private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex lock_;
+    std::condition_variable condition_;
+    std::deque<Job> jobs_;
+    std::vector<Bitmap> results_;
+    std::atomic<bool> hasResults_{ false };
+    bool stop_ = false;
+};
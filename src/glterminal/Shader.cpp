@@ -12,18 +12,64 @@
  * limitations under the License.
  */
 #include <glterminal/Shader.h>
+#include <glterminal/DiskCache.h>
 
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 #include <GL/glew.h>
 #include <glm/matrix.hpp>
 
 using namespace std;
 
+namespace {
+    /// Category of DiskCache entries holding linked program binaries.
+    constexpr auto ProgramCacheCategory = "programs";
+
+    bool programBinariesSupported()
+    {
+        if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1)
+            return false;
+
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    /// @returns a key identifying the program built from the given sources by the current driver.
+    ///
+    /// Program binaries are only valid for the driver (and version of it) that produced them.
+    uint64_t programCacheKey(string const& _vertexCode, string const& _fragmentCode, string const& _geometryCode)
+    {
+        auto const glString = [](GLenum _name) -> string_view {
+            auto const value = reinterpret_cast<char const*>(glGetString(_name));
+            return value ? value : "";
+        };
+
+        auto key = DiskCache::hash(glString(GL_VENDOR));
+        key = DiskCache::hash(glString(GL_RENDERER), key);
+        key = DiskCache::hash(glString(GL_VERSION), key);
+        key = DiskCache::hash(glString(GL_SHADING_LANGUAGE_VERSION), key);
+        key = DiskCache::hash(_vertexCode, key);
+        key = DiskCache::hash(_fragmentCode, key);
+        key = DiskCache::hash(_geometryCode, key);
+        return key;
+    }
+}
+
 Shader::Shader(string const& vertexCode, string const& fragmentCode, string const& geometryCode)
 {
+    uint64_t const cacheKey = DiskCache::enabled() && programBinariesSupported()
+        ? programCacheKey(vertexCode, fragmentCode, geometryCode)
+        : 0;
+
+    if (cacheKey && loadProgramBinary(cacheKey))
+        return;
+
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
@@ -58,6 +104,9 @@ Shader::Shader(string const& vertexCode, string const& fragmentCode, string cons
     if (!geometryCode.empty())
         glAttachShader(id_, geometry);
 
+    if (cacheKey)
+        glProgramParameteri(id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
     glLinkProgram(id_);
     checkCompileErrors(id_, "PROGRAM");
 
@@ -66,6 +115,48 @@ Shader::Shader(string const& vertexCode, string const& fragmentCode, string cons
     glDeleteShader(fragment);
     if (!geometryCode.empty())
         glDeleteShader(geometry);
+
+    if (cacheKey)
+        storeProgramBinary(cacheKey);
+}
+
+bool Shader::loadProgramBinary(uint64_t _cacheKey)
+{
+    // Entries consist of the binary format, followed by the binary itself.
+    auto const data = DiskCache::read(ProgramCacheCategory, _cacheKey);
+    if (!data || data->size() <= sizeof(GLenum))
+        return false;
+
+    GLenum format{};
+    memcpy(&format, data->data(), sizeof(format));
+
+    id_ = glCreateProgram();
+    glProgramBinary(id_, format, data->data() + sizeof(format), static_cast<GLsizei>(data->size() - sizeof(format)));
+
+    // Drivers reject binaries they cannot use (anymore), in which case the program is built from source.
+    GLint success = GL_FALSE;
+    glGetProgramiv(id_, GL_LINK_STATUS, &success);
+    if (success)
+        return true;
+
+    glDeleteProgram(id_);
+    id_ = 0;
+    return false;
+}
+
+void Shader::storeProgramBinary(uint64_t _cacheKey) const
+{
+    GLint length = 0;
+    glGetProgramiv(id_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    GLenum format{};
+    auto data = vector<uint8_t>(sizeof(format) + static_cast<size_t>(length));
+    glGetProgramBinary(id_, length, nullptr, &format, data.data() + sizeof(format));
+    memcpy(data.data(), &format, sizeof(format));
+
+    DiskCache::write(ProgramCacheCategory, _cacheKey, data);
 }
 
 Shader::~Shader()
@@ -13,6 +13,7 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <GL/glew.h>
@@ -23,6 +24,10 @@ class Shader
 public:
     operator unsigned int () const noexcept { return id_; }
 
+    /// Compiles and links a program from the given sources.
+    ///
+    /// If a DiskCache is enabled, linked programs are cached as binaries, keyed by driver and sources,
+    /// and loaded from there instead of being compiled again.
     Shader(std::string const& vertexCode, std::string const& fragmentCode, std::string const& geometryCode = "");
     ~Shader();
 
@@ -51,6 +56,8 @@ public:
 
 private:
     void checkCompileErrors(GLuint _shader, std::string _type);
+    bool loadProgramBinary(uint64_t _cacheKey);
+    void storeProgramBinary(uint64_t _cacheKey) const;
 
 private:
     unsigned int id_{};
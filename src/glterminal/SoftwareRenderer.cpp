@@ -0,0 +1,403 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/SoftwareRenderer.h>
+
+#include <terminal/Tracer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace terminal;
+
+namespace {
+    /// Blends a single 8-bit channel: (_dst * (255 - _alpha) + _src * _alpha) / 255, rounded.
+    inline uint8_t blendChannel(unsigned _dst, unsigned _src, unsigned _alpha) noexcept
+    {
+        unsigned const x = _dst * (255 - _alpha) + _src * _alpha + 128;
+        return static_cast<uint8_t>((x + (x >> 8)) >> 8);
+    }
+
+    // {{{ PNG encoding
+    uint32_t crc32(uint8_t const* _data, size_t _size, uint32_t _crc = 0) noexcept
+    {
+        static auto const table = []() {
+            auto t = array<uint32_t, 256>{};
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        _crc = ~_crc;
+        for (size_t i = 0; i < _size; ++i)
+            _crc = table[(_crc ^ _data[i]) & 0xFF] ^ (_crc >> 8);
+        return ~_crc;
+    }
+
+    void appendBigEndian(string& _output, uint32_t _value)
+    {
+        _output.push_back(static_cast<char>(_value >> 24));
+        _output.push_back(static_cast<char>(_value >> 16));
+        _output.push_back(static_cast<char>(_value >> 8));
+        _output.push_back(static_cast<char>(_value));
+    }
+
+    void writeChunk(ostream& _output, char const _type[4], string const& _data)
+    {
+        auto chunk = string{};
+        appendBigEndian(chunk, static_cast<uint32_t>(_data.size()));
+        chunk.append(_type, 4);
+        chunk.append(_data);
+        auto const crc = crc32(reinterpret_cast<uint8_t const*>(chunk.data() + 4), chunk.size() - 4);
+        appendBigEndian(chunk, crc);
+        _output.write(chunk.data(), static_cast<streamsize>(chunk.size()));
+    }
+    // }}}
+}
+
+void detail::blendSpan(uint32_t* _pixels, uint8_t const* _coverage, size_t _count, uint32_t _color) noexcept
+{
+    size_t i = 0;
+
+    #if defined(__SSE2__)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const max = _mm_set1_epi16(255);
+    __m128i const bias = _mm_set1_epi16(128);
+    __m128i const color = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(_color)), zero);
+
+    auto const blend = [&](__m128i _dst, __m128i _alpha) {
+        // 8 channels of 16 bits each, sums stay below 2^16.
+        __m128i x = _mm_add_epi16(_mm_mullo_epi16(_dst, _mm_sub_epi16(max, _alpha)),
+                                  _mm_mullo_epi16(color, _alpha));
+        x = _mm_add_epi16(x, bias);
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    };
+
+    for (; i + 4 <= _count; i += 4)
+    {
+        uint32_t coverage;
+        memcpy(&coverage, _coverage + i, sizeof(coverage));
+        if (!coverage)
+            continue;
+
+        // Replicate each pixel's coverage into all four of its channels.
+        __m128i alpha = _mm_cvtsi32_si128(static_cast<int>(coverage));
+        alpha = _mm_unpacklo_epi8(alpha, alpha);
+        alpha = _mm_unpacklo_epi16(alpha, alpha);
+
+        __m128i const dst = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_pixels + i));
+        __m128i const lo = blend(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(alpha, zero));
+        __m128i const hi = blend(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(alpha, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(_pixels + i), _mm_packus_epi16(lo, hi));
+    }
+    #endif
+
+    blendSpanScalar(_pixels + i, _coverage + i, _count - i, _color);
+}
+
+void detail::blendSpanScalar(uint32_t* _pixels, uint8_t const* _coverage, size_t _count, uint32_t _color) noexcept
+{
+    uint8_t src[4];
+    memcpy(src, &_color, sizeof(src));
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (unsigned const alpha = _coverage[i]; alpha)
+        {
+            uint8_t dst[4];
+            memcpy(dst, &_pixels[i], sizeof(dst));
+            for (size_t k = 0; k < 4; ++k)
+                dst[k] = blendChannel(dst[k], src[k], alpha);
+            memcpy(&_pixels[i], dst, sizeof(dst));
+        }
+    }
+}
+
+SoftwareRenderer::SoftwareRenderer(Font& _regularFont, ColorProfile const& _colorProfile, Opacity _backgroundOpacity) :
+    regularFont_{ _regularFont },
+    colorProfile_{ _colorProfile },
+    colors_{ _colorProfile },
+    backgroundOpacity_{ _backgroundOpacity }
+{
+}
+
+void SoftwareRenderer::invalidate()
+{
+    colors_ = PackedColorTable{ colorProfile_ };
+    fill(begin(drawn_), end(drawn_), false);
+}
+
+void SoftwareRenderer::resize(WindowSize const& _size)
+{
+    Font& font = regularFont_.get();
+
+    if (font.fontSize() != fontSize_)
+    {
+        fontSize_ = font.fontSize();
+        glyphs_.clear();
+    }
+
+    size_ = _size;
+    cellWidth_ = font.maxAdvance();
+    cellHeight_ = font.lineHeight();
+    width_ = size_.columns * cellWidth_;
+    height_ = size_.rows * cellHeight_;
+
+    pixels_.assign(size_t{width_} * height_, 0);
+    cells_.assign(size_t{size_.columns} * size_.rows, Screen::Cell{});
+    drawn_.assign(cells_.size(), false);
+}
+
+size_t SoftwareRenderer::render(Screen const& _screen)
+{
+    return render(_screen.size(), [&](Screen::Renderer const& _renderer) { _screen.render(_renderer); });
+}
+
+size_t SoftwareRenderer::render(WindowSize const& _size, CellSource const& _cells)
+{
+    TRACE_SCOPE("SoftwareRenderer.render");
+
+    Font const& font = regularFont_.get();
+    if (_size != size_ || font.fontSize() != fontSize_
+            || font.maxAdvance() != cellWidth_ || font.lineHeight() != cellHeight_)
+        resize(_size);
+
+    size_t redrawn = 0;
+    _cells([&](cursor_pos_t _row, cursor_pos_t _col, Screen::Cell const& _cell) {
+        if (_row == 0 || _row > size_.rows || _col == 0 || _col > size_.columns)
+            return;
+
+        auto const index = (_row - 1) * size_.columns + (_col - 1);
+        if (drawn_[index] && cells_[index] == _cell)
+            return;
+
+        drawCell(_row, _col, _cell);
+        cells_[index] = _cell;
+        drawn_[index] = true;
+        ++redrawn;
+    });
+
+    return redrawn;
+}
+
+void SoftwareRenderer::drawCell(cursor_pos_t _row, cursor_pos_t _col, Screen::Cell const& _cell)
+{
+    auto const& attributes = _cell.attributes;
+    bool const bright = attributes.styles & CharacterStyleMask::Bold;
+
+    uint8_t const alpha = (attributes.styles & CharacterStyleMask::Hidden) ? 0
+                        : (attributes.styles & CharacterStyleMask::Faint) ? 0x80
+                        : 0xFF;
+    uint8_t const backgroundAlpha = static_cast<uint8_t>(alpha * static_cast<unsigned>(backgroundOpacity_) / 255);
+
+    // The foreground is blended as an opaque color, at a coverage scaled down by its alpha,
+    // so that faint text blends into its background rather than carrying its alpha into the pixels.
+    bool const inverse = attributes.styles & CharacterStyleMask::Inverse;
+    uint8_t const foregroundAlpha = inverse ? backgroundAlpha : alpha;
+    uint32_t const foreground = inverse
+        ? colors_.resolve(attributes.backgroundColor, ColorTarget::Background, bright, 0xFF)
+        : colors_.resolve(attributes.foregroundColor, ColorTarget::Foreground, bright, 0xFF);
+    uint32_t const background = inverse
+        ? colors_.resolve(attributes.foregroundColor, ColorTarget::Foreground, bright, alpha)
+        : colors_.resolve(attributes.backgroundColor, ColorTarget::Background, bright, backgroundAlpha);
+
+    unsigned const left = (_col - 1) * cellWidth_;
+    unsigned const top = (_row - 1) * cellHeight_;
+    auto const rowPixels = [&](unsigned _y) { return &pixels_[size_t{top + _y} * width_ + left]; };
+
+    for (unsigned y = 0; y < cellHeight_; ++y)
+        fill_n(rowPixels(y), cellWidth_, background);
+
+    if ((attributes.styles & CharacterStyleMask::Hidden) || foregroundAlpha == 0)
+        return;
+
+    auto const scaled = [&](uint8_t const* _coverage, size_t _count) -> uint8_t const* {
+        if (foregroundAlpha == 0xFF)
+            return _coverage;
+        coverage_.resize(_count);
+        for (size_t i = 0; i < _count; ++i)
+            coverage_[i] = blendChannel(0, _coverage[i], foregroundAlpha);
+        return coverage_.data();
+    };
+
+    auto const line = [&](unsigned _y) {
+        if (_y >= cellHeight_)
+            return;
+        if (foregroundAlpha == 0xFF)
+            fill_n(rowPixels(_y), cellWidth_, foreground);
+        else
+        {
+            coverage_.assign(cellWidth_, foregroundAlpha);
+            detail::blendSpan(rowPixels(_y), coverage_.data(), cellWidth_, foreground);
+        }
+    };
+
+    unsigned const baseline = cellHeight_ - regularFont_.get().baseline(); // from the cell's top
+    if (attributes.styles & CharacterStyleMask::DoublyUnderlined)
+    {
+        line(baseline + 1);
+        line(baseline + 3);
+    }
+    else if (attributes.styles & CharacterStyleMask::Underline)
+        line(baseline + 1);
+
+    if (attributes.styles & CharacterStyleMask::CrossedOut)
+        line(cellHeight_ / 2);
+
+    if (_cell.character == 0 || _cell.character == ' ')
+        return;
+
+    GlyphBitmap const& bitmap = glyph(_cell.character);
+
+    // Clip the bitmap to the cell.
+    int const x0 = max(bitmap.left, 0);
+    int const x1 = min(bitmap.left + static_cast<int>(bitmap.width), static_cast<int>(cellWidth_));
+    int const y0 = max(static_cast<int>(baseline) - bitmap.top, 0);
+    int const y1 = min(static_cast<int>(baseline) - bitmap.top + static_cast<int>(bitmap.rows),
+                       static_cast<int>(cellHeight_));
+
+    for (int y = y0; y < y1 && x0 < x1; ++y)
+    {
+        auto const bitmapRow = static_cast<size_t>(y - (static_cast<int>(baseline) - bitmap.top));
+        auto const count = static_cast<size_t>(x1 - x0);
+        detail::blendSpan(rowPixels(static_cast<unsigned>(y)) + x0,
+                  scaled(&bitmap.alpha[bitmapRow * bitmap.width + static_cast<size_t>(x0 - bitmap.left)], count),
+                  count,
+                  foreground);
+    }
+}
+
+SoftwareRenderer::GlyphBitmap const& SoftwareRenderer::glyph(char32_t _char)
+{
+    if (auto const i = glyphs_.find(_char); i != glyphs_.end())
+        return i->second;
+
+    Font& primary = regularFont_.get();
+    auto const resolution = primary.resolve(_char);
+    Font& font = primary.fallback(resolution.font);
+
+    auto bitmap = GlyphBitmap{0, 0, 0, 0, {}};
+    try
+    {
+        font.loadGlyphByIndex(resolution.glyphIndex);
+
+        auto const& glyph = *font->glyph;
+        bitmap.left = glyph.bitmap_left;
+        bitmap.top = glyph.bitmap_top;
+        bitmap.width = glyph.bitmap.width;
+        bitmap.rows = glyph.bitmap.rows;
+        bitmap.alpha.resize(size_t{bitmap.width} * bitmap.rows);
+
+        for (unsigned y = 0; y < bitmap.rows; ++y)
+        {
+            uint8_t const* source = glyph.bitmap.buffer + static_cast<ptrdiff_t>(y) * glyph.bitmap.pitch;
+            uint8_t* target = &bitmap.alpha[size_t{y} * bitmap.width];
+            if (glyph.bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+                for (unsigned x = 0; x < bitmap.width; ++x)
+                    target[x] = (source[x / 8] & (0x80 >> (x % 8))) ? 0xFF : 0x00;
+            else
+                memcpy(target, source, bitmap.width);
+        }
+    }
+    catch (runtime_error const&)
+    {
+        // Render the cell without glyph.
+        bitmap = GlyphBitmap{0, 0, 0, 0, {}};
+    }
+
+    return glyphs_.emplace(_char, move(bitmap)).first->second;
+}
+
+void SoftwareRenderer::writePPM(ostream& _output) const
+{
+    detail::writePPM(_output, data(), width_, height_);
+}
+
+void SoftwareRenderer::writePNG(ostream& _output) const
+{
+    detail::writePNG(_output, data(), width_, height_);
+}
+
+void detail::writePPM(ostream& _output, uint8_t const* _pixels, unsigned _width, unsigned _height)
+{
+    _output << "P6\n" << _width << ' ' << _height << "\n255\n";
+
+    auto row = string(size_t{_width} * 3, '\0');
+    for (unsigned y = 0; y < _height; ++y)
+    {
+        uint8_t const* pixel = _pixels + size_t{y} * _width * 4;
+        for (unsigned x = 0; x < _width; ++x, pixel += 4)
+            memcpy(&row[size_t{x} * 3], pixel, 3);
+        _output.write(row.data(), static_cast<streamsize>(row.size()));
+    }
+}
+
+void detail::writePNG(ostream& _output, uint8_t const* _pixels, unsigned _width, unsigned _height)
+{
+    _output.write("\x89PNG\r\n\x1a\n", 8);
+
+    auto header = string{};
+    appendBigEndian(header, _width);
+    appendBigEndian(header, _height);
+    header += string{"\x08\x06\x00\x00\x00", 5}; // 8 bits per channel, RGBA, deflate, no filter, no interlace
+    writeChunk(_output, "IHDR", header);
+
+    // Scanlines, each prefixed by its filter type (none).
+    auto raw = string{};
+    raw.reserve(size_t{_height} * (1 + size_t{_width} * 4));
+    for (unsigned y = 0; y < _height; ++y)
+    {
+        raw.push_back('\0');
+        raw.append(reinterpret_cast<char const*>(_pixels) + size_t{y} * _width * 4, size_t{_width} * 4);
+    }
+
+    // zlib stream of uncompressed deflate blocks, followed by the Adler-32 checksum.
+    auto zlib = string{"\x78\x01", 2};
+    constexpr size_t MaxBlockSize = 0xFFFF;
+    size_t offset = 0;
+    do
+    {
+        auto const blockSize = min(MaxBlockSize, raw.size() - offset);
+        bool const last = offset + blockSize == raw.size();
+        zlib.push_back(last ? '\x01' : '\x00');
+        zlib.push_back(static_cast<char>(blockSize & 0xFF));
+        zlib.push_back(static_cast<char>(blockSize >> 8));
+        zlib.push_back(static_cast<char>(~blockSize & 0xFF));
+        zlib.push_back(static_cast<char>((~blockSize >> 8) & 0xFF));
+        zlib.append(raw, offset, blockSize);
+        offset += blockSize;
+    }
+    while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (char const ch : raw)
+    {
+        a = (a + static_cast<uint8_t>(ch)) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    writeChunk(_output, "IDAT", zlib);
+    writeChunk(_output, "IEND", string{});
+}
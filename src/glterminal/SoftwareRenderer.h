@@ -0,0 +1,120 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <glterminal/FontManager.h>
+
+#include <terminal/Color.h>
+#include <terminal/Screen.h>
+#include <terminal/WindowSize.h>
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Renders a terminal screen into an RGBA framebuffer in system memory, without requiring OpenGL.
+ *
+ * Meant for headless rendering, such as benchmarks and golden image tests on machines without a GPU,
+ * as well as for displays where OpenGL is emulated slowly.
+ *
+ * Each cell is drawn as a solid background with its glyph alpha blended on top, taken from the font's
+ * FreeType bitmaps. Characters are mapped to glyphs one by one, so ligatures are not rendered, and
+ * glyphs are clipped to their cell. Only cells that changed since the previous render() are drawn again.
+ */
+class SoftwareRenderer {
+  public:
+    /// Feeds every cell of a screen to the given renderer, such as Screen::render or Terminal::render.
+    using CellSource = std::function<void(terminal::Screen::Renderer const&)>;
+
+    SoftwareRenderer(Font& _regularFont,
+                     terminal::ColorProfile const& _colorProfile,
+                     terminal::Opacity _backgroundOpacity = terminal::Opacity::Opaque);
+
+    /// Renders the given screen, only redrawing the cells that changed since the last call.
+    ///
+    /// @returns the number of cells redrawn.
+    size_t render(terminal::Screen const& _screen);
+
+    /// Renders the screen of the given size whose cells are provided by @p _cells.
+    size_t render(terminal::WindowSize const& _size, CellSource const& _cells);
+
+    /// Forces the next render() to redraw all cells, such as after the color profile changed.
+    void invalidate();
+
+    unsigned width() const noexcept { return width_; }
+    unsigned height() const noexcept { return height_; }
+
+    /// Pixels, row by row from top to bottom, each consisting of the bytes red, green, blue and alpha.
+    uint8_t const* data() const noexcept { return reinterpret_cast<uint8_t const*>(pixels_.data()); }
+
+    /// Writes the framebuffer as binary PPM (P6) image, dropping the alpha channel.
+    void writePPM(std::ostream& _output) const;
+
+    /// Writes the framebuffer as RGBA PNG image. Pixel data is stored without compression.
+    void writePNG(std::ostream& _output) const;
+
+  private:
+    struct GlyphBitmap {
+        int left;                    // offset from the pen position to the bitmap's left
+        int top;                     // offset from the baseline up to the bitmap's top
+        unsigned width;
+        unsigned rows;
+        std::vector<uint8_t> alpha;  // tightly packed coverage values
+    };
+
+    void resize(terminal::WindowSize const& _size);
+    void drawCell(terminal::cursor_pos_t _row, terminal::cursor_pos_t _col, terminal::Screen::Cell const& _cell);
+    GlyphBitmap const& glyph(char32_t _char);
+
+  private:
+    std::reference_wrapper<Font> regularFont_;
+    terminal::ColorProfile const& colorProfile_;
+    terminal::PackedColorTable colors_;
+    terminal::Opacity backgroundOpacity_;
+
+    unsigned cellWidth_ = 0;
+    unsigned cellHeight_ = 0;
+    unsigned fontSize_ = 0;
+    terminal::WindowSize size_{};
+    unsigned width_ = 0;
+    unsigned height_ = 0;
+    std::vector<uint32_t> pixels_;
+    std::vector<uint8_t> coverage_; // scratch buffer for blending the foreground at less than full alpha
+
+    /// Cells as last drawn, to tell which cells changed.
+    std::vector<terminal::Screen::Cell> cells_;
+    std::vector<bool> drawn_;
+
+    std::unordered_map<char32_t, GlyphBitmap> glyphs_;
+};
+
+/// Building blocks of the SoftwareRenderer, exposed for testing.
+namespace detail {
+    /// Blends @p _color over @p _count consecutive pixels, weighted by the given coverage values.
+    ///
+    /// Blends four pixels at once where SSE2 is available, yielding the exact same results as blendSpanScalar().
+    void blendSpan(uint32_t* _pixels, uint8_t const* _coverage, size_t _count, uint32_t _color) noexcept;
+
+    /// Blends like blendSpan(), one channel at a time.
+    void blendSpanScalar(uint32_t* _pixels, uint8_t const* _coverage, size_t _count, uint32_t _color) noexcept;
+
+    /// Writes RGBA pixels, row by row from top to bottom, as binary PPM (P6) image, dropping the alpha channel.
+    void writePPM(std::ostream& _output, uint8_t const* _pixels, unsigned _width, unsigned _height);
+
+    /// Writes RGBA pixels, row by row from top to bottom, as PNG image with uncompressed pixel data.
+    void writePNG(std::ostream& _output, uint8_t const* _pixels, unsigned _width, unsigned _height);
+}
@@ -0,0 +1,263 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/SoftwareRenderer.h>
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace terminal;
+using namespace std;
+
+namespace {
+    uint32_t bigEndianAt(string const& _data, size_t _offset)
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset])) << 24
+             | static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset + 1])) << 16
+             | static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset + 2])) << 8
+             | static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset + 3]));
+    }
+
+    /// Concatenates the payload of a zlib stream made of uncompressed deflate blocks.
+    string inflateStored(string const& _zlib)
+    {
+        auto output = string{};
+        size_t offset = 2;
+        bool last = false;
+        while (!last)
+        {
+            last = _zlib.at(offset) & 1;
+            REQUIRE((_zlib[offset] & 0x06) == 0); // BTYPE: no compression
+            auto const length = static_cast<size_t>(static_cast<uint8_t>(_zlib.at(offset + 1))
+                                                  | static_cast<uint8_t>(_zlib.at(offset + 2)) << 8);
+            auto const complement = static_cast<size_t>(static_cast<uint8_t>(_zlib.at(offset + 3))
+                                                      | static_cast<uint8_t>(_zlib.at(offset + 4)) << 8);
+            REQUIRE((length ^ complement) == 0xFFFF);
+            output += _zlib.substr(offset + 5, length);
+            offset += 5 + length;
+        }
+        REQUIRE(offset + 4 == _zlib.size());
+        return output;
+    }
+
+    uint32_t adler32(string const& _data)
+    {
+        uint32_t a = 1, b = 0;
+        for (char const ch : _data)
+        {
+            a = (a + static_cast<uint8_t>(ch)) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+}
+
+TEST_CASE("SoftwareRenderer.blendSpan", "[software_renderer]")
+{
+    auto rng = mt19937{42};
+    auto byte = uniform_int_distribution<unsigned>{0, 255};
+
+    for (size_t count : {0, 1, 3, 4, 5, 16, 37, 100})
+    {
+        auto pixels = vector<uint32_t>(count);
+        auto coverage = vector<uint8_t>(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            pixels[i] = byte(rng) | byte(rng) << 8 | byte(rng) << 16 | byte(rng) << 24;
+            // Mostly fully covered and uncovered pixels, as in glyph bitmaps.
+            switch (byte(rng) % 4)
+            {
+                case 0: coverage[i] = 0; break;
+                case 1: coverage[i] = 0xFF; break;
+                default: coverage[i] = static_cast<uint8_t>(byte(rng)); break;
+            }
+        }
+        uint32_t const color = byte(rng) | byte(rng) << 8 | byte(rng) << 16 | byte(rng) << 24;
+
+        auto simd = pixels;
+        auto scalar = pixels;
+        detail::blendSpan(simd.data(), coverage.data(), count, color);
+        detail::blendSpanScalar(scalar.data(), coverage.data(), count, color);
+
+        INFO("count: " << count);
+        CHECK(simd == scalar);
+    }
+
+    SECTION("extremes") {
+        auto pixels = vector<uint32_t>{0x11223344, 0x11223344, 0x11223344, 0x11223344};
+        auto const coverage = vector<uint8_t>{0x00, 0xFF, 0x00, 0xFF};
+        detail::blendSpan(pixels.data(), coverage.data(), pixels.size(), 0xAABBCCDD);
+        CHECK(pixels == vector<uint32_t>{0x11223344, 0xAABBCCDD, 0x11223344, 0xAABBCCDD});
+    }
+}
+
+TEST_CASE("SoftwareRenderer.writePPM", "[software_renderer]")
+{
+    uint8_t const pixels[] = {0x11, 0x22, 0x33, 0xFF, 0x44, 0x55, 0x66, 0x80};
+    auto output = ostringstream{};
+    detail::writePPM(output, pixels, 2, 1);
+    CHECK(output.str() == string{"P6\n2 1\n255\n\x11\x22\x33\x44\x55\x66"});
+}
+
+TEST_CASE("SoftwareRenderer.writePNG", "[software_renderer]")
+{
+    uint8_t const pixels[] = {0x11, 0x22, 0x33, 0xFF, 0x44, 0x55, 0x66, 0x80};
+    auto output = ostringstream{};
+    detail::writePNG(output, pixels, 2, 1);
+    auto const png = output.str();
+
+    REQUIRE(png.substr(0, 8) == string{"\x89PNG\r\n\x1a\n", 8});
+
+    // IHDR
+    REQUIRE(bigEndianAt(png, 8) == 13);
+    REQUIRE(png.substr(12, 4) == "IHDR");
+    CHECK(bigEndianAt(png, 16) == 2);
+    CHECK(bigEndianAt(png, 20) == 1);
+    CHECK(png.substr(24, 5) == string{"\x08\x06\x00\x00\x00", 5});
+    CHECK(bigEndianAt(png, 29) == 0xF4227F8A);
+
+    // IDAT
+    auto const idatSize = bigEndianAt(png, 33);
+    REQUIRE(png.substr(37, 4) == "IDAT");
+    auto const zlib = png.substr(41, idatSize);
+    CHECK(zlib.substr(0, 2) == "\x78\x01");
+    auto const scanlines = string{"\0\x11\x22\x33\xFF\x44\x55\x66\x80", 9};
+    CHECK(inflateStored(zlib) == scanlines);
+    CHECK(bigEndianAt(zlib, zlib.size() - 4) == 0x0B0702E5);
+    CHECK(bigEndianAt(png, 41 + idatSize) == 0xFD20F582);
+
+    // IEND
+    auto const iend = 45 + idatSize;
+    CHECK(bigEndianAt(png, iend) == 0);
+    CHECK(png.substr(iend + 4, 4) == "IEND");
+    CHECK(bigEndianAt(png, iend + 8) == 0xAE426082);
+    CHECK(png.size() == iend + 12);
+}
+
+TEST_CASE("SoftwareRenderer.writePNG.multipleBlocks", "[software_renderer]")
+{
+    // More than 64 KiB of scanlines, spanning two deflate blocks.
+    unsigned const width = 200;
+    unsigned const height = 100;
+    auto pixels = vector<uint8_t>(size_t{width} * height * 4);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = static_cast<uint8_t>(i * 7);
+
+    auto output = ostringstream{};
+    detail::writePNG(output, pixels.data(), width, height);
+    auto const png = output.str();
+
+    auto const idatSize = bigEndianAt(png, 33);
+    REQUIRE(png.substr(37, 4) == "IDAT");
+    auto const zlib = png.substr(41, idatSize);
+
+    auto scanlines = string{};
+    for (unsigned y = 0; y < height; ++y)
+    {
+        scanlines.push_back('\0');
+        scanlines.append(reinterpret_cast<char const*>(&pixels[size_t{y} * width * 4]), size_t{width} * 4);
+    }
+    CHECK(inflateStored(zlib) == scanlines);
+    CHECK(bigEndianAt(zlib, zlib.size() - 4) == adler32(scanlines));
+}
+
+TEST_CASE("SoftwareRenderer.render", "[software_renderer]")
+{
+    // Only blank cells are rendered, which need the font's metrics but none of its glyphs.
+    auto fontManager = FontManager{filesystem::path{}};
+    Font* font = nullptr;
+    try
+    {
+        font = &fontManager.load("monospace", 12);
+    }
+    catch (exception const& e)
+    {
+        WARN("Skipped, no monospace font available: " << e.what());
+        return;
+    }
+
+    auto const colorProfile = ColorProfile{};
+    auto renderer = SoftwareRenderer{*font, colorProfile};
+    auto screen = Screen{{4, 2}};
+
+    REQUIRE(renderer.render(screen) == 8);
+    CHECK(renderer.width() == 4 * font->maxAdvance());
+    CHECK(renderer.height() == 2 * font->lineHeight());
+    CHECK(renderer.render(screen) == 0);
+
+    auto const pixelAt = [&](unsigned _x, unsigned _y) {
+        auto const* pixel = renderer.data() + (size_t{_y} * renderer.width() + _x) * 4;
+        return RGBColor{pixel[0], pixel[1], pixel[2]};
+    };
+    REQUIRE(pixelAt(0, 0) == colorProfile.defaultBackground);
+
+    // An inversed blank cell in the second line.
+    screen.write("\033[2;3H\033[7m \033[m");
+    CHECK(renderer.render(screen) == 1);
+    CHECK(renderer.render(screen) == 0);
+    CHECK(pixelAt(2 * font->maxAdvance(), font->lineHeight()) == colorProfile.defaultForeground);
+    CHECK(pixelAt(0, 0) == colorProfile.defaultBackground);
+
+    renderer.invalidate();
+    CHECK(renderer.render(screen) == 8);
+}
+
+TEST_CASE("SoftwareRenderer.render.hiddenAndFaint", "[software_renderer]")
+{
+    auto fontManager = FontManager{filesystem::path{}};
+    Font* font = nullptr;
+    try
+    {
+        font = &fontManager.load("monospace", 12);
+    }
+    catch (exception const& e)
+    {
+        WARN("Skipped, no monospace font available: " << e.what());
+        return;
+    }
+
+    auto const colorProfile = ColorProfile{};
+    auto renderer = SoftwareRenderer{*font, colorProfile};
+    auto screen = Screen{{2, 1}};
+
+    // A hidden underlined character, followed by a faint underlined blank.
+    screen.write("\033[4;8mX\033[m\033[2;4m \033[m");
+    REQUIRE(renderer.render(screen) == 2);
+
+    auto const pixelAt = [&](unsigned _x, unsigned _y) {
+        auto const* pixel = renderer.data() + (size_t{_y} * renderer.width() + _x) * 4;
+        return RGBColor{pixel[0], pixel[1], pixel[2]};
+    };
+
+    // Neither the glyph nor the underline of the hidden cell are drawn.
+    for (unsigned y = 0; y < font->lineHeight(); ++y)
+        for (unsigned x = 0; x < font->maxAdvance(); ++x)
+            REQUIRE(pixelAt(x, y) == colorProfile.defaultBackground);
+
+    // The faint underline is blended at half coverage into the background.
+    auto const half = [](uint8_t _background, uint8_t _foreground) {
+        return static_cast<uint8_t>((_background * 0x7F + _foreground * 0x80 + 127) / 255);
+    };
+    auto const& bg = colorProfile.defaultBackground;
+    auto const& fg = colorProfile.defaultForeground;
+    auto const faint = RGBColor{half(bg.red, fg.red), half(bg.green, fg.green), half(bg.blue, fg.blue)};
+    auto const underline = font->lineHeight() - font->baseline() + 1;
+    for (unsigned x = font->maxAdvance(); x < 2 * font->maxAdvance(); ++x)
+    {
+        REQUIRE(pixelAt(x, 0) == bg);
+        REQUIRE(pixelAt(x, underline) == faint);
+    }
+}
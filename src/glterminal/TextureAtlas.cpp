@@ -0,0 +1,165 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <glterminal/TextureAtlas.h>
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    /// Gap in pixels kept between neighboring bitmaps, avoiding bleeding when sampling linearly.
+    /// Pages are zeroed whenever they are emptied, for the gaps to be blank.
+    constexpr unsigned Padding = 1;
+}
+
+TextureAtlas::TextureAtlas(unsigned _maxPages, unsigned _pageSize, EvictionHandler _onEvict) :
+    maxPages_{ max(1u, _maxPages) },
+    pageSize_{ _pageSize },
+    onEvict_{ move(_onEvict) },
+    pages_{}
+{
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    if (maxTextureSize > 0)
+        pageSize_ = min(pageSize_, static_cast<unsigned>(maxTextureSize));
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    for (Page const& page : pages_)
+        glDeleteTextures(1, &page.texture);
+}
+
+void TextureAtlas::createPage()
+{
+    Page page{};
+    glGenTextures(1, &page.texture);
+    glBindTexture(GL_TEXTURE_2D, page.texture);
+    auto const zeros = vector<uint8_t>(size_t{pageSize_} * pageSize_, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, pageSize_, pageSize_, 0, GL_RED, GL_UNSIGNED_BYTE, zeros.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    page.lastUse = ++useClock_;
+    pages_.emplace_back(move(page));
+}
+
+optional<glm::ivec2> TextureAtlas::allocate(Page& _page, unsigned _width, unsigned _height)
+{
+    // best fitting existing shelf, wasting the least vertical space.
+    Shelf* best = nullptr;
+    for (Shelf& shelf : _page.shelves)
+        if (shelf.height >= _height && shelf.x + _width <= pageSize_)
+            if (!best || shelf.height < best->height)
+                best = &shelf;
+
+    // open a new shelf, unless an existing one fits well enough.
+    if ((!best || best->height > _height + _height / 2) && _page.nextShelfY + _height <= pageSize_)
+    {
+        _page.shelves.emplace_back(Shelf{_page.nextShelfY, _height, 0});
+        _page.nextShelfY += _height + Padding;
+        best = &_page.shelves.back();
+    }
+
+    if (!best)
+        return nullopt;
+
+    auto const offset = glm::ivec2{best->x, best->y};
+    best->x += _width + Padding;
+    return offset;
+}
+
+unsigned TextureAtlas::evictLeastRecentlyUsed()
+{
+    auto const i = min_element(begin(pages_), end(pages_),
+                               [](Page const& a, Page const& b) { return a.lastUse < b.lastUse; });
+    auto const pageIndex = static_cast<unsigned>(distance(begin(pages_), i));
+
+    if (onEvict_)
+        onEvict_(pageIndex);
+
+    resetPage(*i);
+    return pageIndex;
+}
+
+void TextureAtlas::resetPage(Page& _page)
+{
+    _page.shelves.clear();
+    _page.nextShelfY = 0;
+
+    auto const zeros = vector<uint8_t>(size_t{pageSize_} * pageSize_, 0);
+    glBindTexture(GL_TEXTURE_2D, _page.texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pageSize_, pageSize_, GL_RED, GL_UNSIGNED_BYTE, zeros.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+optional<TextureAtlas::Region> TextureAtlas::insert(unsigned _width, unsigned _height, uint8_t const* _pixels)
+{
+    if (_width > pageSize_ || _height > pageSize_)
+        return nullopt;
+
+    optional<glm::ivec2> offset;
+    unsigned pageIndex = 0;
+
+    // most recently used pages first, as these are most likely to have space left.
+    for (unsigned i = static_cast<unsigned>(pages_.size()); i > 0 && !offset; --i)
+        if (offset = allocate(pages_[i - 1], _width, _height); offset)
+            pageIndex = i - 1;
+
+    if (!offset)
+    {
+        if (pages_.size() < maxPages_)
+        {
+            createPage();
+            pageIndex = static_cast<unsigned>(pages_.size() - 1);
+        }
+        else
+            pageIndex = evictLeastRecentlyUsed();
+
+        offset = allocate(pages_[pageIndex], _width, _height);
+        if (!offset)
+            return nullopt;
+    }
+
+    Page& page = pages_[pageIndex];
+    page.lastUse = ++useClock_;
+
+    if (_width && _height)
+    {
+        glBindTexture(GL_TEXTURE_2D, page.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, offset->x, offset->y, _width, _height, GL_RED, GL_UNSIGNED_BYTE, _pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    auto const size = static_cast<float>(pageSize_);
+    return Region{
+        pageIndex,
+        *offset,
+        glm::ivec2{_width, _height},
+        glm::vec4{
+            static_cast<float>(offset->x) / size,
+            static_cast<float>(offset->y) / size,
+            static_cast<float>(offset->x + _width) / size,
+            static_cast<float>(offset->y + _height) / size
+        }
+    };
+}
+
+void TextureAtlas::clear()
+{
+    for (Page& page : pages_)
+        resetPage(page);
+}
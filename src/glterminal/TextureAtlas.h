@@ -0,0 +1,98 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+/**
+ * Single-channel (GL_RED) texture atlas, packing many small bitmaps (such as glyphs) into
+ * a few large textures ("pages").
+ *
+ * Bitmaps are packed using a shelf packer: each page is divided into horizontal shelves,
+ * each as high as the first bitmap placed into it, that are filled from left to right.
+ *
+ * When all pages are full, the least recently used page is evicted as a whole.
+ */
+class TextureAtlas {
+  public:
+    /// Location of a bitmap within the atlas.
+    struct Region {
+        unsigned page;      //!< index of the page the bitmap is stored in
+        glm::ivec2 offset;  //!< pixel offset into the page
+        glm::ivec2 size;    //!< bitmap size in pixels
+        glm::vec4 uv;       //!< texture coordinates (left, top, right, bottom) in range [0, 1]
+    };
+
+    /// Callback invoked right before a page is being evicted, to drop any references to it.
+    using EvictionHandler = std::function<void(unsigned /*page*/)>;
+
+    /// @param _maxPages maximum number of textures to allocate.
+    /// @param _pageSize width and height of each texture, clamped to GL_MAX_TEXTURE_SIZE.
+    /// @param _onEvict invoked right before a page is being evicted.
+    TextureAtlas(unsigned _maxPages, unsigned _pageSize, EvictionHandler _onEvict);
+    TextureAtlas(TextureAtlas const&) = delete;
+    TextureAtlas& operator=(TextureAtlas const&) = delete;
+    ~TextureAtlas();
+
+    /// Uploads a tightly packed single-channel bitmap into the atlas.
+    ///
+    /// @returns the bitmap's location or std::nullopt if the bitmap is larger than a page.
+    std::optional<Region> insert(unsigned _width, unsigned _height, uint8_t const* _pixels);
+
+    /// Marks given page as recently used, with respect to eviction.
+    void touch(unsigned _page) noexcept { pages_[_page].lastUse = ++useClock_; }
+
+    /// @returns the GL texture of given page.
+    GLuint texture(unsigned _page) const noexcept { return pages_[_page].texture; }
+
+    size_t pageCount() const noexcept { return pages_.size(); }
+    unsigned pageSize() const noexcept { return pageSize_; }
+
+    /// Evicts all pages, keeping their textures allocated for reuse.
+    void clear();
+
+  private:
+    struct Shelf {
+        unsigned y;
+        unsigned height;
+        unsigned x; // next free column
+    };
+
+    struct Page {
+        GLuint texture;
+        std::vector<Shelf> shelves;
+        unsigned nextShelfY;
+        uint64_t lastUse;
+    };
+
+    std::optional<glm::ivec2> allocate(Page& _page, unsigned _width, unsigned _height);
+    unsigned evictLeastRecentlyUsed();
+    void createPage();
+
+    /// Empties the given page, zeroing its texels such that no stale pixels show up in the padding.
+    void resetPage(Page& _page);
+
+  private:
+    unsigned const maxPages_;
+    unsigned pageSize_;
+    EvictionHandler onEvict_;
+    std::vector<Page> pages_;
+    uint64_t useClock_ = 0;
+};
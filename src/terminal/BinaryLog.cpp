@@ -0,0 +1,461 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/BinaryLog.h>
+#include <terminal/Util.h>
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace terminal {
+
+namespace {
+    /// Bit in EntryHeader::state, marking the entry as fully written by its producer.
+    constexpr uint64_t Committed = uint64_t{1} << 63;
+
+    /// Entry kind of the filler entries at the ring buffer's end, that are skipped when draining.
+    constexpr uint32_t PaddingKind = 0xFFFF;
+
+    constexpr size_t align16(size_t _value) noexcept
+    {
+        return (_value + 15) & ~size_t{15};
+    }
+
+    size_t roundUpToPowerOfTwo(size_t _value) noexcept
+    {
+        size_t result = 4096;
+        while (result < _value)
+            result <<= 1;
+        return result;
+    }
+
+    uint64_t now() noexcept
+    {
+        return static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count()
+        );
+    }
+
+    template <typename T>
+    T decodeEvent(string_view _payload)
+    {
+        return T{string(_payload)};
+    }
+
+    template <>
+    InvalidOutputEvent decodeEvent<InvalidOutputEvent>(string_view _payload)
+    {
+        auto const i = _payload.find('\0');
+        if (i == string_view::npos)
+            return InvalidOutputEvent{string(_payload), ""};
+        else
+            return InvalidOutputEvent{string(_payload.substr(0, i)), string(_payload.substr(i + 1))};
+    }
+
+    template <typename T>
+    string const& commandText(T const& _value) noexcept
+    {
+        if constexpr (is_same_v<T, ChangeWindowTitle>)
+            return _value.title;
+        else
+        {
+            static_assert(is_same_v<T, ChangeIconName>, "Command must be trivially copyable or handled here.");
+            return _value.name;
+        }
+    }
+
+    void encodeCommands(vector<Command> const& _commands, string& _output)
+    {
+        static_assert(variant_size_v<Command> <= 0x100);
+
+        _output.clear();
+        for (Command const& command : _commands)
+        {
+            _output.push_back(static_cast<char>(command.index()));
+            visit(
+                [&](auto const& _value) {
+                    using T = decay_t<decltype(_value)>;
+                    if constexpr (is_trivially_copyable_v<T>)
+                        _output.append(reinterpret_cast<char const*>(&_value), sizeof(T));
+                    else
+                    {
+                        auto const& text = commandText(_value);
+                        auto const size = static_cast<uint32_t>(text.size());
+                        _output.append(reinterpret_cast<char const*>(&size), sizeof(size));
+                        _output.append(text);
+                    }
+                },
+                command
+            );
+        }
+    }
+
+    /// Decodes the value of the command of given variant index from the front of @p _payload.
+    template <size_t I = 0>
+    optional<Command> decodeCommand(size_t _index, string_view& _payload)
+    {
+        if constexpr (I < variant_size_v<Command>)
+        {
+            if (_index != I)
+                return decodeCommand<I + 1>(_index, _payload);
+
+            using T = variant_alternative_t<I, Command>;
+            if constexpr (is_trivially_copyable_v<T>)
+            {
+                if (_payload.size() < sizeof(T))
+                    return nullopt;
+                T value{};
+                memcpy(static_cast<void*>(&value), _payload.data(), sizeof(T));
+                _payload.remove_prefix(sizeof(T));
+                return Command{in_place_index<I>, value};
+            }
+            else
+            {
+                uint32_t size = 0;
+                if (_payload.size() < sizeof(size))
+                    return nullopt;
+                memcpy(&size, _payload.data(), sizeof(size));
+                _payload.remove_prefix(sizeof(size));
+                if (_payload.size() < size)
+                    return nullopt;
+                auto text = string(_payload.substr(0, size));
+                _payload.remove_prefix(size);
+                return Command{in_place_index<I>, T{move(text)}};
+            }
+        }
+        else
+            return nullopt;
+    }
+
+    vector<Command> decodeCommands(string_view _payload)
+    {
+        auto commands = vector<Command>{};
+        while (!_payload.empty())
+        {
+            auto const index = static_cast<uint8_t>(_payload.front());
+            _payload.remove_prefix(1);
+            auto command = decodeCommand(index, _payload);
+            if (!command.has_value())
+                throw runtime_error{ "Corrupted binary log record." };
+            commands.emplace_back(move(*command));
+        }
+        return commands;
+    }
+
+    template <size_t I = 0>
+    optional<LogEvent> decodeEvent(size_t _kind, string_view _payload)
+    {
+        if constexpr (I < variant_size_v<LogEvent>)
+        {
+            if (_kind == I)
+                return LogEvent{in_place_index<I>, decodeEvent<variant_alternative_t<I, LogEvent>>(_payload)};
+            else
+                return decodeEvent<I + 1>(_kind, _payload);
+        }
+        else
+            return nullopt;
+    }
+}
+
+// {{{ BinaryLogWriter
+BinaryLogWriter::BinaryLogWriter(string const& _filePath, size_t _capacity) :
+    file_{ _filePath, ios::binary | ios::trunc },
+    capacity_{ roundUpToPowerOfTwo(_capacity) },
+    storage_{ make_unique<EntryHeader[]>(capacity_ / sizeof(EntryHeader)) },
+    buffer_{ reinterpret_cast<uint8_t*>(storage_.get()) }
+{
+    if (!file_.good())
+        throw runtime_error{ "Failed to open binary log file. " + _filePath };
+
+    memset(static_cast<void*>(buffer_), 0, capacity_);
+
+    binlog::FileHeader header{};
+    memcpy(header.magic, binlog::Magic, sizeof(header.magic));
+    file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    writer_ = thread{ &BinaryLogWriter::writerThread, this };
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+    {
+        lock_guard<mutex> _l{ mutex_ };
+        exit_ = true;
+    }
+    wakeup_.notify_one();
+    writer_.join();
+}
+
+bool BinaryLogWriter::write(LogEvent const& _event)
+{
+    auto const kind = static_cast<uint32_t>(_event.index());
+    return visit(overloaded{
+            [&](ParserErrorEvent const& v) { return append(kind, v.reason, {}); },
+            [&](TraceInputEvent const& v) { return append(kind, v.message, {}); },
+            [&](RawInputEvent const& v) { return append(kind, v.sequence, {}); },
+            [&](RawOutputEvent const& v) { return append(kind, v.sequence, {}); },
+            [&](InvalidOutputEvent const& v) { return append(kind, v.sequence, v.reason); },
+            [&](UnsupportedOutputEvent const& v) { return append(kind, v.sequence, {}); },
+            [&](TraceOutputEvent const& v) { return append(kind, v.sequence, {}); },
+        },
+        _event
+    );
+}
+
+bool BinaryLogWriter::write(vector<Command> const& _commands)
+{
+    // Reused across calls, so that encoding does not allocate once it has grown large enough.
+    thread_local string payload;
+    encodeCommands(_commands, payload);
+    return append(binlog::CommandsKind, payload, {});
+}
+
+/// Appends a single entry to the ring buffer.
+///
+/// The payload is made of @p _first and, if not empty, a NUL byte followed by @p _second.
+///
+/// Producers reserve their entry's space by advancing head_ and then fill it at their own pace.
+/// An entry becomes visible to the writer thread as soon as its header's state has the Committed
+/// bit set. If an entry would not fit between head_ and the end of the buffer, a padding entry
+/// is put in front of it, so that entries never wrap around.
+bool BinaryLogWriter::append(uint32_t _kind, string_view _first, string_view _second)
+{
+    auto const secondSize = _second.empty() ? 0 : 1 + _second.size();
+    auto const payloadSize = _first.size() + secondSize;
+    auto const entrySize = align16(sizeof(EntryHeader) + payloadSize);
+
+    if (entrySize > capacity_ / 2)
+    {
+        dropped_.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    uint64_t head = head_.load(memory_order_relaxed);
+    uint64_t padding = 0;
+    for (;;)
+    {
+        auto const toEnd = capacity_ - (head & (capacity_ - 1));
+        padding = entrySize > toEnd ? toEnd : 0;
+        if (head + padding + entrySize - tail_.load(memory_order_acquire) > capacity_)
+        {
+            dropped_.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        if (head_.compare_exchange_weak(head, head + padding + entrySize, memory_order_relaxed))
+            break;
+    }
+
+    auto const start = head;
+    if (padding)
+    {
+        headerAt(head)->state.store(Committed | (uint64_t{PaddingKind} << 32) | (padding - sizeof(EntryHeader)));
+        head += padding;
+    }
+
+    EntryHeader* header = headerAt(head);
+    header->timestamp = now();
+
+    auto* payload = reinterpret_cast<char*>(header + 1);
+    memcpy(payload, _first.data(), _first.size());
+    if (secondSize)
+    {
+        payload[_first.size()] = '\0';
+        memcpy(payload + _first.size() + 1, _second.data(), _second.size());
+    }
+
+    header->state.store(Committed | (uint64_t{_kind} << 32) | payloadSize);
+
+    // The writer thread sleeps while the entry at tail_ is not committed, so it is woken up by the
+    // producer committing that entry. Either that producer sees the writer having drained up to its
+    // entry, or the writer sees the entry committed (see drainable()), as both are sequentially consistent.
+    // The writer may be waiting on this producer's padding entry as well as on its actual entry.
+    if (auto const tail = tail_.load(); start <= tail && tail <= head)
+    {
+        lock_guard<mutex> _l{ mutex_ };
+        wakeup_.notify_one();
+    }
+    else if (head + entrySize - tail_.load(memory_order_relaxed) > capacity_ / 2)
+        wakeup_.notify_one(); // ends the writer's batching delay early
+
+    return true;
+}
+
+/// Moves all committed entries from the ring buffer into a single chunk of the log file.
+bool BinaryLogWriter::drain()
+{
+    records_.clear();
+    payload_.clear();
+
+    auto tail = tail_.load(memory_order_relaxed);
+    auto const head = head_.load(memory_order_acquire);
+
+    while (tail != head)
+    {
+        EntryHeader* header = headerAt(tail);
+        auto const state = header->state.load(memory_order_acquire);
+        if (!(state & Committed))
+            break; // producer is still writing this one
+
+        auto const kind = static_cast<uint32_t>((state >> 32) & 0xFFFF);
+        auto const payloadSize = static_cast<uint32_t>(state & 0xFFFFFFFF);
+        auto const entrySize = align16(sizeof(EntryHeader) + payloadSize);
+
+        if (kind != PaddingKind)
+        {
+            records_.emplace_back(binlog::Record{
+                header->timestamp,
+                kind,
+                static_cast<uint32_t>(payload_.size()),
+                payloadSize,
+                0
+            });
+            payload_.append(reinterpret_cast<char const*>(header + 1), payloadSize);
+        }
+
+        // Zero out the entry, so that stale payload is never mistaken for a committed header.
+        memset(static_cast<void*>(header), 0, entrySize);
+        tail += entrySize;
+    }
+
+    tail_.store(tail);
+
+    if (auto const dropped = dropped_.load(memory_order_relaxed); dropped != droppedReported_)
+    {
+        auto const count = std::to_string(dropped - droppedReported_);
+        records_.emplace_back(binlog::Record{
+            now(),
+            binlog::DroppedKind,
+            static_cast<uint32_t>(payload_.size()),
+            static_cast<uint32_t>(count.size()),
+            0
+        });
+        payload_ += count;
+        droppedReported_ = dropped;
+    }
+
+    if (records_.empty())
+        return false;
+
+    auto const chunk = binlog::ChunkHeader{
+        static_cast<uint32_t>(records_.size()),
+        static_cast<uint32_t>(payload_.size())
+    };
+    file_.write(reinterpret_cast<char const*>(&chunk), sizeof(chunk));
+    file_.write(reinterpret_cast<char const*>(records_.data()), records_.size() * sizeof(binlog::Record));
+    file_.write(payload_.data(), payload_.size());
+    file_.flush();
+
+    return true;
+}
+
+bool BinaryLogWriter::drainable() noexcept
+{
+    return headerAt(tail_.load())->state.load() & Committed;
+}
+
+void BinaryLogWriter::writerThread()
+{
+    unique_lock<mutex> lock{ mutex_ };
+    while (!exit_ || tail_.load(memory_order_relaxed) != head_.load(memory_order_acquire))
+    {
+        // Sleeps for as long as there is nothing to drain, then lets further entries accumulate
+        // for a moment to write them as a single chunk.
+        wakeup_.wait(lock, [this]() { return exit_ || drainable(); });
+        wakeup_.wait_for(lock, chrono::milliseconds(50), [this]() { return exit_ || flushRequested_; });
+        flushRequested_ = false;
+
+        lock.unlock();
+        drain();
+        wakeups_.fetch_add(1, memory_order_relaxed);
+        lock.lock();
+
+        drained_.notify_all();
+    }
+
+    // report any events dropped since the last drain
+    drain();
+}
+
+void BinaryLogWriter::flush()
+{
+    auto const target = head_.load(memory_order_acquire);
+    unique_lock<mutex> lock{ mutex_ };
+    if (tail_.load(memory_order_acquire) < target)
+    {
+        flushRequested_ = true;
+        wakeup_.notify_one();
+    }
+    drained_.wait(lock, [&]() { return tail_.load(memory_order_acquire) >= target; });
+}
+// }}}
+
+// {{{ BinaryLogReader
+BinaryLogReader::BinaryLogReader(istream& _input) :
+    input_{ _input }
+{
+    binlog::FileHeader header{};
+    if (!input_.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || memcmp(header.magic, binlog::Magic, sizeof(header.magic)) != 0)
+        throw runtime_error{ "Input is not a binary log." };
+}
+
+bool BinaryLogReader::readChunk()
+{
+    binlog::ChunkHeader chunk{};
+    if (!input_.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+        return false;
+
+    records_.resize(chunk.recordCount);
+    payload_.resize(chunk.payloadSize);
+    current_ = 0;
+
+    input_.read(reinterpret_cast<char*>(records_.data()), records_.size() * sizeof(binlog::Record));
+    input_.read(payload_.data(), payload_.size());
+
+    return input_.good();
+}
+
+optional<BinaryLogReader::Entry> BinaryLogReader::next()
+{
+    for (;;)
+    {
+        while (current_ >= records_.size())
+            if (!readChunk())
+                return nullopt;
+
+        binlog::Record const& record = records_[current_++];
+        if (record.payloadOffset + record.payloadSize > payload_.size())
+            throw runtime_error{ "Corrupted binary log record." };
+
+        auto const timestamp = chrono::system_clock::time_point{
+            chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(record.timestamp))
+        };
+        auto const payload = string_view{payload_}.substr(record.payloadOffset, record.payloadSize);
+
+        if (record.kind == binlog::DroppedKind)
+            return Entry{timestamp, nullopt, stoull(string(payload)), nullopt};
+
+        if (record.kind == binlog::CommandsKind)
+            return Entry{timestamp, nullopt, 0, decodeCommands(payload)};
+
+        if (auto event = decodeEvent(record.kind, payload); event.has_value())
+            return Entry{timestamp, move(event), 0, nullopt};
+
+        // skip records of unknown kind
+    }
+}
+// }}}
+
+}  // namespace terminal
@@ -0,0 +1,186 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Commands.h>
+#include <terminal/Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace terminal {
+
+/**
+ * Binary log file format.
+ *
+ * The file starts with a FileHeader, followed by any number of chunks.
+ * Each chunk consists of a ChunkHeader, followed by ChunkHeader::recordCount fixed-size Record's,
+ * followed by ChunkHeader::payloadSize bytes of payload that the records point into.
+ *
+ * All values are stored in host byte order. The payload of CommandsKind records holds the screen's
+ * commands in the memory layout of the build that wrote them, so only that build can decode them.
+ */
+namespace binlog {
+    constexpr char Magic[8] = { 'C', 'T', 'B', 'L', 'O', 'G', '\0', '\1' };
+
+    /// Record kind for a synthesized record carrying the number of dropped events.
+    constexpr uint32_t DroppedKind = 0xFFFE;
+
+    /// Record kind for a batch of screen commands. Each command is stored as its variant index byte,
+    /// followed by its value, or by a uint32_t size and the text of commands carrying a string.
+    constexpr uint32_t CommandsKind = 0xFFFD;
+
+    struct FileHeader {
+        char magic[8];
+    };
+
+    struct ChunkHeader {
+        uint32_t recordCount;
+        uint32_t payloadSize;
+    };
+
+    struct Record {
+        uint64_t timestamp;     //!< nanoseconds since epoch (system clock)
+        uint32_t kind;          //!< LogEvent's variant index or DroppedKind
+        uint32_t payloadOffset; //!< offset into the chunk's payload
+        uint32_t payloadSize;   //!< number of payload bytes
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Record) == 24);
+}
+
+/**
+ * Writes LogEvent's into a compact binary file.
+ *
+ * Events are appended to a lock-free multi-producer ring buffer by the logging threads
+ * without any formatting, and drained by a background thread that writes them in chunks
+ * into the log file.
+ *
+ * If the ring buffer is full, the event gets dropped and accounted for,
+ * so that logging never blocks the caller.
+ *
+ * @see BinaryLogReader
+ */
+class BinaryLogWriter {
+  public:
+    /// @param _filePath path to the binary log file to create (or truncate).
+    /// @param _capacity ring buffer size in bytes, rounded up to the next power of two.
+    explicit BinaryLogWriter(std::string const& _filePath, size_t _capacity = 4 * 1024 * 1024);
+    BinaryLogWriter(BinaryLogWriter const&) = delete;
+    BinaryLogWriter& operator=(BinaryLogWriter const&) = delete;
+    ~BinaryLogWriter();
+
+    /// Appends given event to the log without blocking.
+    ///
+    /// @retval true event was successfully queued.
+    /// @retval false event was dropped due to the ring buffer being full.
+    bool write(LogEvent const& _event);
+
+    /// Appends given screen commands to the log without blocking, leaving their formatting to the reader.
+    ///
+    /// @retval true commands were successfully queued.
+    /// @retval false commands were dropped due to the ring buffer being full.
+    bool write(std::vector<Command> const& _commands);
+
+    /// Blocks until all events written so far have been written to the log file.
+    void flush();
+
+    /// @returns the total number of events dropped so far.
+    uint64_t droppedCount() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    /// @returns the number of times the writer thread woke up to drain the ring buffer.
+    uint64_t wakeupCount() const noexcept { return wakeups_.load(std::memory_order_relaxed); }
+
+  private:
+    bool append(uint32_t _kind, std::string_view _first, std::string_view _second);
+    bool drain();
+    void writerThread();
+
+    /// @returns whether the entry at tail_ is committed, that is, there is something to drain.
+    bool drainable() noexcept;
+
+    struct alignas(16) EntryHeader {
+        std::atomic<uint64_t> state; // committed-bit | kind << 32 | payloadSize
+        uint64_t timestamp;
+    };
+    static_assert(sizeof(EntryHeader) == 16);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    EntryHeader* headerAt(uint64_t _position) noexcept
+    {
+        return reinterpret_cast<EntryHeader*>(&buffer_[_position & (capacity_ - 1)]);
+    }
+
+  private:
+    std::ofstream file_;
+    size_t const capacity_;
+    std::unique_ptr<EntryHeader[]> storage_;
+    uint8_t* buffer_;
+
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) std::atomic<uint64_t> dropped_{0};
+    uint64_t droppedReported_ = 0;
+
+    std::vector<binlog::Record> records_;
+    std::string payload_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable drained_;
+    bool flushRequested_ = false;
+    bool exit_ = false;
+    std::atomic<uint64_t> wakeups_{0};
+    std::thread writer_;
+};
+
+/// Reads binary log files as written by BinaryLogWriter.
+class BinaryLogReader {
+  public:
+    struct Entry {
+        std::chrono::system_clock::time_point timestamp;
+        std::optional<LogEvent> event;  //!< the event, or std::nullopt for a dropped-events marker or commands.
+        uint64_t droppedCount = 0;      //!< number of events dropped at this point, if neither event nor commands are set.
+        std::optional<std::vector<Command>> commands; //!< screen commands, as written by BinaryLogWriter::write().
+    };
+
+    /// @throws std::runtime_error if the input is not a binary log.
+    explicit BinaryLogReader(std::istream& _input);
+
+    /// @returns the next entry or std::nullopt at the end of the log.
+    std::optional<Entry> next();
+
+  private:
+    bool readChunk();
+
+  private:
+    std::istream& input_;
+    std::vector<binlog::Record> records_;
+    std::string payload_;
+    size_t current_ = 0;
+};
+
+}  // namespace terminal
@@ -0,0 +1,228 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/BinaryLog.h>
+#include <terminal/OutputHandler.h>
+#include <terminal/Parser.h>
+#include <catch2/catch.hpp>
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace terminal;
+
+namespace {
+    string tempLogFile(string const& _name)
+    {
+        return (filesystem::temp_directory_path() / fmt::format("{}-{}.binlog", _name, getpid())).string();
+    }
+}
+
+TEST_CASE("BinaryLog.roundtrip", "[BinaryLog]")
+{
+    auto const filePath = tempLogFile("roundtrip");
+    auto const events = vector<LogEvent>{
+        ParserErrorEvent{"some reason"},
+        TraceInputEvent{"key: Enter"},
+        RawInputEvent{"\033[A"},
+        RawOutputEvent{string("\0binary\xFF", 8)},
+        InvalidOutputEvent{"\033[?9999h", "Unknown mode."},
+        InvalidOutputEvent{"\033x", ""},
+        UnsupportedOutputEvent{"DECSCUSR"},
+        TraceOutputEvent{""},
+    };
+
+    {
+        auto writer = BinaryLogWriter{filePath};
+        for (auto const& event : events)
+            REQUIRE(writer.write(event));
+        writer.flush();
+    }
+
+    auto input = ifstream{filePath, ios::binary};
+    auto reader = BinaryLogReader{input};
+    for (auto const& event : events)
+    {
+        auto const entry = reader.next();
+        REQUIRE(entry.has_value());
+        REQUIRE(entry->event.has_value());
+        CHECK(entry->event->index() == event.index());
+        CHECK(fmt::format("{}", *entry->event) == fmt::format("{}", event));
+    }
+    CHECK_FALSE(reader.next().has_value());
+
+    remove(filePath.c_str());
+}
+
+TEST_CASE("BinaryLog.commands", "[BinaryLog]")
+{
+    auto const filePath = tempLogFile("commands");
+    auto handler = OutputHandler{25, {}};
+    auto parser = Parser{ref(handler)};
+    auto const output = string{"\033]2;some title\033\\\033[1;31mHello\033[m\033[3;4H\r\n\033[?25l"};
+    parser.parseFragment(output.data(), output.size());
+    auto const commands = handler.commands();
+    REQUIRE(commands.size() > 2);
+    CHECK(holds_alternative<ChangeWindowTitle>(commands.front()));
+
+    {
+        auto writer = BinaryLogWriter{filePath};
+        REQUIRE(writer.write(commands));
+        REQUIRE(writer.write(vector<Command>{}));
+        writer.flush();
+    }
+
+    auto input = ifstream{filePath, ios::binary};
+    auto reader = BinaryLogReader{input};
+
+    auto entry = reader.next();
+    REQUIRE(entry.has_value());
+    CHECK_FALSE(entry->event.has_value());
+    REQUIRE(entry->commands.has_value());
+    CHECK(to_mnemonic(*entry->commands, true, true) == to_mnemonic(commands, true, true));
+
+    entry = reader.next();
+    REQUIRE(entry.has_value());
+    REQUIRE(entry->commands.has_value());
+    CHECK(entry->commands->empty());
+
+    CHECK_FALSE(reader.next().has_value());
+
+    remove(filePath.c_str());
+}
+
+TEST_CASE("BinaryLog.wraparound_and_drops", "[BinaryLog]")
+{
+    auto const filePath = tempLogFile("wraparound");
+    auto const payload = string(1000, 'x');
+    size_t constexpr ThreadCount = 4;
+    size_t constexpr EventsPerThread = 2000;
+
+    uint64_t dropped = 0;
+    {
+        // a tiny ring buffer, so that it wraps around plenty of times and (likely) overflows.
+        auto writer = BinaryLogWriter{filePath, 8192};
+        auto threads = vector<thread>{};
+        for (size_t i = 0; i < ThreadCount; ++i)
+            threads.emplace_back([&]() {
+                for (size_t k = 0; k < EventsPerThread; ++k)
+                    writer.write(RawOutputEvent{payload});
+            });
+        for (auto& t : threads)
+            t.join();
+        writer.flush();
+        dropped = writer.droppedCount();
+    }
+
+    auto input = ifstream{filePath, ios::binary};
+    auto reader = BinaryLogReader{input};
+    uint64_t received = 0;
+    uint64_t reportedDrops = 0;
+    while (auto const entry = reader.next())
+    {
+        if (entry->event.has_value())
+        {
+            REQUIRE(get<RawOutputEvent>(*entry->event).sequence == payload);
+            ++received;
+        }
+        else
+            reportedDrops += entry->droppedCount;
+    }
+
+    CHECK(reportedDrops == dropped);
+    CHECK(received + dropped == ThreadCount * EventsPerThread);
+
+    remove(filePath.c_str());
+}
+
+TEST_CASE("BinaryLog.idle", "[BinaryLog]")
+{
+    using namespace std::chrono_literals;
+    auto const filePath = tempLogFile("idle");
+    {
+        auto writer = BinaryLogWriter{filePath};
+        this_thread::sleep_for(200ms);
+        CHECK(writer.wakeupCount() == 0);
+
+        // Drained without a flush, and without waking up again afterwards.
+        REQUIRE(writer.write(TraceOutputEvent{"first"}));
+        this_thread::sleep_for(200ms);
+        CHECK(writer.wakeupCount() == 1);
+
+        REQUIRE(writer.write(TraceOutputEvent{"second"}));
+        writer.flush();
+        CHECK(writer.wakeupCount() == 2);
+        this_thread::sleep_for(200ms);
+        CHECK(writer.wakeupCount() == 2);
+    }
+
+    auto input = ifstream{filePath, ios::binary};
+    auto reader = BinaryLogReader{input};
+    for (auto const* expected : {"first", "second"})
+    {
+        auto const entry = reader.next();
+        REQUIRE(entry.has_value());
+        REQUIRE(entry->event.has_value());
+        CHECK(get<TraceOutputEvent>(*entry->event).sequence == expected);
+    }
+    CHECK_FALSE(reader.next().has_value());
+
+    remove(filePath.c_str());
+}
+
+TEST_CASE("BinaryLog.wraparound_idle", "[BinaryLog]")
+{
+    using namespace std::chrono_literals;
+    auto const filePath = tempLogFile("wraparound_idle");
+    auto const payload = string(400, 'x'); // 416 byte entries, not dividing the ring evenly
+    size_t constexpr EventCount = 12;
+    {
+        auto writer = BinaryLogWriter{filePath, 4096};
+        for (size_t i = 1; i <= EventCount; ++i)
+        {
+            // Each entry is drained on its own while the writer is idle, including those behind a padding entry.
+            REQUIRE(writer.write(RawOutputEvent{payload}));
+            for (int k = 0; k < 200 && writer.wakeupCount() < i; ++k)
+                this_thread::sleep_for(5ms);
+            REQUIRE(writer.wakeupCount() == i);
+        }
+    }
+
+    auto input = ifstream{filePath, ios::binary};
+    auto reader = BinaryLogReader{input};
+    size_t received = 0;
+    while (auto const entry = reader.next())
+    {
+        REQUIRE(entry->event.has_value());
+        CHECK(get<RawOutputEvent>(*entry->event).sequence == payload);
+        ++received;
+    }
+    CHECK(received == EventCount);
+
+    remove(filePath.c_str());
+}
+
+TEST_CASE("BinaryLog.invalid_input", "[BinaryLog]")
+{
+    auto input = istringstream{"not a binary log"};
+    REQUIRE_THROWS_AS(BinaryLogReader{input}, runtime_error);
+}
@@ -136,4 +136,13 @@ RGBColor const& apply(ColorProfile const& _profile, Color const& _color, ColorTa
     );
 }
 
+PackedColorTable::PackedColorTable(ColorProfile const& _profile) noexcept
+{
+    for (size_t i = 0; i < _profile.palette.size(); ++i)
+        colors_[i] = pack(_profile.palette[i], 0);
+
+    colors_[DefaultForeground] = pack(_profile.defaultForeground, 0);
+    colors_[DefaultBackground] = pack(_profile.defaultBackground, 0);
+}
+
 }  // namespace terminal
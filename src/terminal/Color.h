@@ -16,7 +16,9 @@
 #include <fmt/format.h>
 
 #include <array>
+#include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <initializer_list>
 #include <string>
 #include <variant>
@@ -159,6 +161,18 @@ struct ColorProfile {
     }();
 };
 
+inline bool operator==(ColorProfile const& a, ColorProfile const& b) noexcept
+{
+    return a.defaultForeground == b.defaultForeground
+        && a.defaultBackground == b.defaultBackground
+        && a.palette == b.palette;
+}
+
+inline bool operator!=(ColorProfile const& a, ColorProfile const& b) noexcept
+{
+    return !(a == b);
+}
+
 enum class ColorTarget {
     Foreground,
     Background,
@@ -181,6 +195,50 @@ constexpr Opacity& operator--(Opacity& _value) noexcept {
 
 RGBColor const& apply(ColorProfile const& _colorProfile, Color const& _color, ColorTarget _target, bool _bright) noexcept;
 
+/// @returns the given color packed such that its bytes in memory are in order red, green, blue, alpha.
+inline uint32_t pack(RGBColor const& _rgb, uint8_t _alpha) noexcept
+{
+    auto const bytes = std::array<uint8_t, 4>{_rgb.red, _rgb.green, _rgb.blue, _alpha};
+    uint32_t color;
+    std::memcpy(&color, bytes.data(), sizeof(color));
+    return color;
+}
+
+/// Colors of a ColorProfile, resolved ahead of time into packed RGBA values (see pack()).
+///
+/// Resolving a color costs a single table lookup, except for RGB colors, which are packed as they are.
+/// The table must be rebuilt whenever the profile it was built from changed.
+class PackedColorTable {
+  public:
+    explicit PackedColorTable(ColorProfile const& _profile) noexcept;
+
+    /// Same as pack(apply(profile, _color, _target, _bright), _alpha).
+    uint32_t resolve(Color const& _color, ColorTarget _target, bool _bright, uint8_t _alpha) const noexcept
+    {
+        return lookup(_color, _target, _bright) | pack(RGBColor{}, _alpha);
+    }
+
+  private:
+    uint32_t lookup(Color const& _color, ColorTarget _target, bool _bright) const noexcept
+    {
+        if (auto const indexed = std::get_if<IndexedColor>(&_color); indexed)
+        {
+            auto const index = static_cast<size_t>(*indexed);
+            return colors_[_bright && index < 8 ? index + 8 : index];
+        }
+        if (auto const bright = std::get_if<BrightColor>(&_color); bright)
+            return colors_[static_cast<size_t>(*bright) + 8];
+        if (auto const rgb = std::get_if<RGBColor>(&_color); rgb)
+            return pack(*rgb, 0);
+        return colors_[_target == ColorTarget::Foreground ? DefaultForeground : DefaultBackground];
+    }
+
+    static constexpr size_t DefaultForeground = 256;
+    static constexpr size_t DefaultBackground = 257;
+
+    std::array<uint32_t, 258> colors_; // indexed colors, followed by the default colors, all of alpha 0
+};
+
 constexpr bool operator==(Color const& a, Color const& b) noexcept
 {
     if (a.index() != b.index())
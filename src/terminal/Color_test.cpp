@@ -0,0 +1,56 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Color.h>
+#include <catch2/catch.hpp>
+
+using namespace terminal;
+using namespace std;
+
+TEST_CASE("PackedColorTable.resolve", "[color]")
+{
+    auto profile = ColorProfile{};
+    profile.defaultForeground = 0x102030_rgb;
+    profile.defaultBackground = 0x405060_rgb;
+    auto const table = PackedColorTable{profile};
+
+    auto const check = [&](Color const& _color, ColorTarget _target, bool _bright) {
+        INFO(to_string(_color));
+        CHECK(table.resolve(_color, _target, _bright, 0x80) == pack(apply(profile, _color, _target, _bright), 0x80));
+    };
+
+    for (auto const target : {ColorTarget::Foreground, ColorTarget::Background})
+        for (auto const bright : {false, true})
+        {
+            check(UndefinedColor{}, target, bright);
+            check(DefaultColor{}, target, bright);
+            check(RGBColor{0x11, 0x22, 0x33}, target, bright);
+            for (unsigned i = 0; i < 8; ++i)
+            {
+                check(static_cast<IndexedColor>(i), target, bright);
+                check(static_cast<BrightColor>(i), target, bright);
+            }
+            for (unsigned i = 16; i < 256; i += 15)
+                check(static_cast<IndexedColor>(i), target, bright);
+        }
+}
+
+TEST_CASE("PackedColorTable.pack", "[color]")
+{
+    auto const color = pack(RGBColor{1, 2, 3}, 4);
+    auto const bytes = reinterpret_cast<uint8_t const*>(&color);
+    CHECK(bytes[0] == 1);
+    CHECK(bytes[1] == 2);
+    CHECK(bytes[2] == 3);
+    CHECK(bytes[3] == 4);
+}
@@ -0,0 +1,87 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+namespace terminal {
+
+/**
+ * Schedules the blinking of the text cursor.
+ *
+ * The cursor is shown for one interval, then hidden for one, and so on. Blinking restarts with the
+ * cursor shown whenever reset() is called, such as when the cursor moved or a key was pressed.
+ *
+ * While blinking is disabled or the window is unfocused, the cursor is shown steadily and
+ * no changes are scheduled at all, allowing the caller to sleep until the next event.
+ */
+class CursorBlink {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CursorBlink(bool _enabled = true,
+                         Clock::duration _interval = std::chrono::milliseconds{500},
+                         Clock::time_point _now = Clock::now()) noexcept :
+        enabled_{ _enabled },
+        interval_{ _interval },
+        start_{ _now }
+    {}
+
+    bool enabled() const noexcept { return enabled_; }
+    void setEnabled(bool _enabled, Clock::time_point _now = Clock::now()) noexcept
+    {
+        enabled_ = _enabled;
+        reset(_now);
+    }
+
+    bool focused() const noexcept { return focused_; }
+    void setFocused(bool _focused, Clock::time_point _now = Clock::now()) noexcept
+    {
+        focused_ = _focused;
+        reset(_now);
+    }
+
+    /// Restarts blinking with the cursor shown.
+    void reset(Clock::time_point _now = Clock::now()) noexcept { start_ = _now; }
+
+    /// @returns whether the cursor is shown at the given time.
+    bool visible(Clock::time_point _now = Clock::now()) const noexcept
+    {
+        return !active() || _now < start_ || ((_now - start_) / interval_) % 2 == 0;
+    }
+
+    /// @returns the first time after @p _now the cursor is shown or hidden, or nothing if it never is.
+    std::optional<Clock::time_point> nextChange(Clock::time_point _now = Clock::now()) const noexcept
+    {
+        if (!active())
+            return std::nullopt;
+
+        if (_now < start_)
+            return start_ + interval_;
+
+        return start_ + ((_now - start_) / interval_ + 1) * interval_;
+    }
+
+  private:
+    bool active() const noexcept { return enabled_ && focused_ && interval_.count() > 0; }
+
+  private:
+    bool enabled_;
+    bool focused_ = true;
+    Clock::duration interval_;
+    Clock::time_point start_;
+};
+
+}  // namespace terminal
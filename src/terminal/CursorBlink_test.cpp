@@ -0,0 +1,131 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/CursorBlink.h>
+#include <terminal/IdleTimeout.h>
+#include <catch2/catch.hpp>
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace terminal;
+using namespace std;
+using namespace std::chrono_literals;
+
+namespace {
+    using Clock = CursorBlink::Clock;
+
+    /// Simulates an idle main loop that sleeps as long as idleTimeout() permits, or for good if there is no limit.
+    ///
+    /// @returns the number of wakeups within the given period, checking the cursor toggles on each.
+    unsigned idleWakeups(CursorBlink const& _blink, Clock::time_point _start, Clock::duration _period)
+    {
+        unsigned wakeups = 0;
+        auto now = _start;
+        while (auto const timeout = idleTimeout({_blink.nextChange(now)}, now))
+        {
+            if (now + *timeout > _start + _period)
+                break;
+
+            auto const wasVisible = _blink.visible(now);
+            now += *timeout;
+            CHECK(_blink.visible(now) != wasVisible);
+            ++wakeups;
+        }
+        return wakeups;
+    }
+}
+
+TEST_CASE("CursorBlink.idle", "[cursor]")
+{
+    auto const start = Clock::time_point{} + 1h;
+
+    SECTION("blinking") {
+        auto const blink = CursorBlink{true, 500ms, start};
+        CHECK(blink.visible(start));
+        CHECK(!blink.visible(start + 500ms));
+        CHECK(idleWakeups(blink, start, 10s) == 20);
+    }
+
+    SECTION("disabled") {
+        auto const blink = CursorBlink{false, 500ms, start};
+        CHECK(idleWakeups(blink, start, 10s) == 0);
+        CHECK(blink.visible(start + 750ms));
+    }
+
+    SECTION("unfocused") {
+        auto blink = CursorBlink{true, 500ms, start};
+        blink.setFocused(false, start);
+        CHECK(idleWakeups(blink, start, 10s) == 0);
+        CHECK(blink.visible(start + 750ms));
+
+        blink.setFocused(true, start + 10s);
+        CHECK(blink.nextChange(start + 10s) == start + 10s + 500ms);
+    }
+}
+
+TEST_CASE("CursorBlink.reset", "[cursor]")
+{
+    auto const start = Clock::time_point{} + 1h;
+    auto blink = CursorBlink{true, 500ms, start};
+
+    CHECK(!blink.visible(start + 700ms));
+    CHECK(blink.nextChange(start + 700ms) == start + 1000ms);
+
+    // e.g. a key press, showing the cursor right away
+    blink.reset(start + 700ms);
+    CHECK(blink.visible(start + 700ms));
+    CHECK(blink.nextChange(start + 700ms) == start + 1200ms);
+    CHECK(!blink.visible(start + 1200ms));
+}
+
+TEST_CASE("CursorBlink.idleLoop", "[cursor]")
+{
+    // Runs an idle loop for real, waiting on a condition no event is ever signaled on,
+    // just like the main loop waits for window events.
+    auto const runFor = [](CursorBlink const& _blink, Clock::duration _period) {
+        auto eventLock = mutex{};
+        auto events = condition_variable{};
+        auto lock = unique_lock<mutex>{eventLock};
+        auto const end = Clock::now() + _period;
+        unsigned wakeups = 0;
+        while (Clock::now() < end)
+        {
+            auto const deadline = _blink.nextChange();
+            auto const timeout = idleTimeout({deadline, end});
+            REQUIRE(timeout.has_value());
+            events.wait_for(lock, *timeout, []() { return false; });
+            if (deadline && Clock::now() >= *deadline)
+                ++wakeups;
+            CHECK(Clock::now() >= min(deadline.value_or(end), end));
+        }
+        return wakeups;
+    };
+
+    CHECK(runFor(CursorBlink{false, 20ms}, 200ms) == 0);
+
+    // Blinks at 50, 100, ..., 250ms, give or take a late wakeup on a busy machine.
+    auto const blinks = runFor(CursorBlink{true, 50ms}, 275ms);
+    CHECK(blinks >= 4);
+    CHECK(blinks <= 5);
+}
+
+TEST_CASE("idleTimeout", "[cursor]")
+{
+    auto const now = Clock::time_point{} + 1h;
+    CHECK(!idleTimeout({}, now).has_value());
+    CHECK(!idleTimeout({nullopt, nullopt}, now).has_value());
+    CHECK(idleTimeout({now + 500ms}, now) == Clock::duration{500ms});
+    CHECK(idleTimeout({now + 500ms, nullopt, now + 100ms}, now) == Clock::duration{100ms});
+    CHECK(idleTimeout({now - 100ms, now + 100ms}, now) == Clock::duration::zero());
+}
@@ -0,0 +1,45 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
+#include <optional>
+
+namespace terminal {
+
+/// Computes how long an idle event loop may sleep, such as until the cursor's next blink.
+///
+/// @param _deadlines times the loop must wake up at, unset ones being ignored.
+/// @param _now current time.
+///
+/// @returns the time until the earliest deadline, zero if it passed already,
+///          or nothing if the loop may sleep until the next event.
+inline std::optional<std::chrono::steady_clock::duration> idleTimeout(
+    std::initializer_list<std::optional<std::chrono::steady_clock::time_point>> _deadlines,
+    std::chrono::steady_clock::time_point _now = std::chrono::steady_clock::now())
+{
+    std::optional<std::chrono::steady_clock::time_point> earliest;
+    for (auto const& deadline : _deadlines)
+        if (deadline && (!earliest || *deadline < *earliest))
+            earliest = deadline;
+
+    if (!earliest)
+        return std::nullopt;
+
+    return std::max(*earliest - _now, std::chrono::steady_clock::duration::zero());
+}
+
+}  // namespace terminal
@@ -0,0 +1,114 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Telemetry.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace terminal {
+
+/**
+ * Measures the end-to-end latency of user input, that is, from sending input to the PTY,
+ * until the application's echo has been applied to the screen and, finally, presented on a frame.
+ *
+ * Only one input is measured at a time: input sent while a measurement is in flight is
+ * considered to be answered by the same echo. The first output applied after sending input
+ * is considered to be the echo.
+ *
+ * All member functions are thread-safe.
+ */
+class InputLatency {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// To be invoked when input has been written to the PTY.
+    void inputSent(Clock::time_point _now = Clock::now()) noexcept
+    {
+        int64_t expected = 0;
+        pendingSince_.compare_exchange_strong(expected, ticks(_now), std::memory_order_relaxed);
+    }
+
+    /// To be invoked after output from the PTY has been applied to the screen.
+    void outputApplied(Clock::time_point _now = Clock::now()) noexcept
+    {
+        if (pendingSince_.load(std::memory_order_relaxed) == 0)
+            return;
+
+        if (auto const since = pendingSince_.exchange(0, std::memory_order_relaxed); since != 0)
+        {
+            inputToApplied_.record(static_cast<uint64_t>(ticks(_now) - since));
+            int64_t expected = 0;
+            appliedSince_.compare_exchange_strong(expected, since, std::memory_order_relaxed);
+        }
+    }
+
+    /// To be invoked after a frame has been presented to the user (i.e. after swapping buffers).
+    void framePresented(Clock::time_point _now = Clock::now()) noexcept
+    {
+        if (appliedSince_.load(std::memory_order_relaxed) == 0)
+            return;
+
+        if (auto const since = appliedSince_.exchange(0, std::memory_order_relaxed); since != 0)
+            inputToFrame_.record(static_cast<uint64_t>(ticks(_now) - since));
+    }
+
+    /// Latency in nanoseconds from sending input until its echo has been applied to the screen.
+    Histogram const& inputToApplied() const noexcept { return inputToApplied_; }
+
+    /// Latency in nanoseconds from sending input until its echo has been presented on screen.
+    Histogram const& inputToFrame() const noexcept { return inputToFrame_; }
+
+    void reset() noexcept
+    {
+        pendingSince_.store(0, std::memory_order_relaxed);
+        appliedSince_.store(0, std::memory_order_relaxed);
+        inputToApplied_.reset();
+        inputToFrame_.reset();
+    }
+
+    /// @returns a human readable summary of the measurements so far.
+    std::string summary() const
+    {
+        auto const format = [](char const* _name, Histogram const& _h) {
+            return fmt::format("{}: count={} min={:.3f}ms p50={:.3f}ms p99={:.3f}ms max={:.3f}ms",
+                               _name, _h.count(),
+                               static_cast<double>(_h.min()) / 1e6,
+                               static_cast<double>(_h.percentile(50)) / 1e6,
+                               static_cast<double>(_h.percentile(99)) / 1e6,
+                               static_cast<double>(_h.max()) / 1e6);
+        };
+        return format("input to applied", inputToApplied_) + "\n" + format("input to frame", inputToFrame_);
+    }
+
+  private:
+    static int64_t ticks(Clock::time_point _time) noexcept
+    {
+        // never 0, as 0 denotes "no measurement in flight".
+        return std::max(int64_t{1}, static_cast<int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(_time.time_since_epoch()).count()));
+    }
+
+    std::atomic<int64_t> pendingSince_{0};
+    std::atomic<int64_t> appliedSince_{0};
+    Histogram inputToApplied_;
+    Histogram inputToFrame_;
+};
+
+}  // namespace terminal
@@ -0,0 +1,90 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/InputLatency.h>
+#include <terminal/Process.h>
+#include <terminal/Terminal.h>
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace terminal;
+using namespace std;
+using namespace std::chrono_literals;
+
+TEST_CASE("InputLatency.measurements", "[latency]")
+{
+    auto latency = InputLatency{};
+    auto const t0 = InputLatency::Clock::time_point{} + 1s;
+
+    // output without any pending input is not accounted.
+    latency.outputApplied(t0);
+    latency.framePresented(t0);
+    CHECK(latency.inputToApplied().count() == 0);
+    CHECK(latency.inputToFrame().count() == 0);
+
+    // further input while waiting for the echo belongs to the same measurement.
+    latency.inputSent(t0);
+    latency.inputSent(t0 + 1ms);
+    latency.outputApplied(t0 + 3ms);
+    latency.outputApplied(t0 + 4ms);
+    latency.framePresented(t0 + 10ms);
+    latency.framePresented(t0 + 20ms);
+
+    CHECK(latency.inputToApplied().count() == 1);
+    CHECK(latency.inputToApplied().min() == 3'000'000);
+    CHECK(latency.inputToFrame().count() == 1);
+    CHECK(latency.inputToFrame().min() == 10'000'000);
+
+    latency.reset();
+    CHECK(latency.inputToApplied().count() == 0);
+}
+
+TEST_CASE("InputLatency.echo_child", "[latency]")
+{
+    // Measures the non-GL part of the input path against a local child process,
+    // with the PTY's line discipline echoing the input.
+    auto terminal = Terminal{WindowSize{80, 25}};
+    auto process = Process{terminal, "cat", {"cat"}, {}};
+
+    int constexpr KeyPresses = 5;
+    for (int i = 0; i < KeyPresses; ++i)
+    {
+        auto const expected = static_cast<uint64_t>(i + 1);
+        terminal.send(static_cast<char32_t>('a' + i));
+
+        auto const timeout = chrono::steady_clock::now() + 5s;
+        while (terminal.inputLatency().inputToApplied().count() < expected && chrono::steady_clock::now() < timeout)
+            this_thread::sleep_for(1ms);
+
+        REQUIRE(terminal.inputLatency().inputToApplied().count() == expected);
+    }
+
+    // Presenting a frame closes the pending measurement.
+    terminal.inputLatency().framePresented();
+    CHECK(terminal.inputLatency().inputToFrame().count() == 1);
+
+    auto const& applied = terminal.inputLatency().inputToApplied();
+    CHECK(applied.min() > 0);
+    CHECK(applied.min() <= applied.percentile(50));
+    CHECK(applied.percentile(50) <= applied.percentile(99));
+    CHECK(applied.percentile(99) <= applied.max());
+    UNSCOPED_INFO(terminal.inputLatency().summary());
+
+    // end input (^D on an empty line) and let cat terminate.
+    terminal.send(Key::Enter);
+    terminal.send('d', Modifier::Control);
+    (void) process.wait();
+    terminal.wait();
+}
@@ -0,0 +1,101 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace terminal {
+
+/**
+ * Bounded key/value cache, evicting the least recently used entry when full.
+ *
+ * Lookups are counted as hits or misses.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LRUCache {
+  public:
+    explicit LRUCache(size_t _capacity) : capacity_{ _capacity ? _capacity : 1 } {}
+
+    size_t size() const noexcept { return entries_.size(); }
+    size_t capacity() const noexcept { return capacity_; }
+
+    uint64_t hits() const noexcept { return hits_; }
+    uint64_t misses() const noexcept { return misses_; }
+
+    /// @returns pointer to the value associated with @p _key, marking it most recently used,
+    ///          or nullptr if not present.
+    Value* get(Key const& _key)
+    {
+        auto const i = index_.find(_key);
+        if (i == index_.end())
+        {
+            ++misses_;
+            return nullptr;
+        }
+
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, i->second);
+        return &i->second->second;
+    }
+
+    /// Associates @p _value with @p _key, evicting the least recently used entry if full.
+    ///
+    /// @returns reference to the stored value, valid until it is evicted.
+    Value& put(Key _key, Value _value)
+    {
+        if (auto const i = index_.find(_key); i != index_.end())
+        {
+            i->second->second = std::move(_value);
+            entries_.splice(entries_.begin(), entries_, i->second);
+            return i->second->second;
+        }
+
+        if (entries_.size() == capacity_)
+        {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+
+        entries_.emplace_front(std::move(_key), std::move(_value));
+        index_.emplace(entries_.front().first, entries_.begin());
+        return entries_.front().second;
+    }
+
+    void clear()
+    {
+        index_.clear();
+        entries_.clear();
+    }
+
+    void resetCounters() noexcept
+    {
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+  private:
+    using Entries = std::list<std::pair<Key, Value>>;
+
+    size_t capacity_;
+    Entries entries_; // most recently used first
+    std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+}  // namespace terminal
@@ -0,0 +1,72 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/LRUCache.h>
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace terminal;
+using namespace std;
+
+TEST_CASE("LRUCache.get_put", "[lru]")
+{
+    auto cache = LRUCache<string, int>{4};
+    CHECK(cache.get("a") == nullptr);
+
+    cache.put("a", 1);
+    cache.put("b", 2);
+    REQUIRE(cache.get("a") != nullptr);
+    CHECK(*cache.get("a") == 1);
+    CHECK(*cache.get("b") == 2);
+    CHECK(cache.size() == 2);
+
+    cache.put("a", 3);
+    CHECK(*cache.get("a") == 3);
+    CHECK(cache.size() == 2);
+
+    CHECK(cache.hits() == 4);
+    CHECK(cache.misses() == 1);
+}
+
+TEST_CASE("LRUCache.evicts_least_recently_used", "[lru]")
+{
+    auto cache = LRUCache<int, int>{3};
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+
+    // touching 1 makes 2 the least recently used entry
+    CHECK(cache.get(1) != nullptr);
+    cache.put(4, 40);
+
+    CHECK(cache.size() == 3);
+    CHECK(cache.get(2) == nullptr);
+    CHECK(cache.get(1) != nullptr);
+    CHECK(cache.get(3) != nullptr);
+    CHECK(cache.get(4) != nullptr);
+}
+
+TEST_CASE("LRUCache.clear", "[lru]")
+{
+    auto cache = LRUCache<int, int>{2};
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.clear();
+    CHECK(cache.size() == 0);
+    CHECK(cache.get(1) == nullptr);
+
+    cache.resetCounters();
+    CHECK(cache.hits() == 0);
+    CHECK(cache.misses() == 0);
+}
@@ -15,6 +15,7 @@
 
 #include <terminal/Logger.h>
 #include <terminal/Parser.h>
+#include <terminal/Telemetry.h>
 
 #include <string>
 #include <string_view>
@@ -29,9 +30,10 @@ class OutputHandler {
 
     size_t constexpr static MaxParameters = 16;
 
-    OutputHandler(unsigned int _rows, Logger _logger)
+    OutputHandler(unsigned int _rows, Logger _logger, Telemetry* _telemetry = nullptr)
         : rowCount_{_rows},
-          logger_{std::move(_logger)}
+          logger_{std::move(_logger)},
+          telemetry_{_telemetry}
     {
         parameters_.reserve(MaxParameters);
     }
@@ -89,7 +91,9 @@ class OutputHandler {
     void emit(Args&&... args)
     {
         commands_.emplace_back(T{std::forward<Args>(args)...});
-        // TODO: telemetry_.increment(fmt::format("{}.{}", "Command", typeid(T).name()));
+        if constexpr (Telemetry::Enabled)
+            if (telemetry_)
+                telemetry_->countCommand(commands_.back().index());
     }
 
     template <typename Event, typename... Args>
@@ -122,6 +126,7 @@ class OutputHandler {
     unsigned int rowCount_;
 
     Logger const logger_;
+    Telemetry* const telemetry_;
 };
 
 }  // namespace terminal
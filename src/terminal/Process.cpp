@@ -25,6 +25,7 @@
 #if !defined(_MSC_VER)
 #include <utmp.h>
 #include <pwd.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -119,7 +120,7 @@ Process::Process(
     switch (pid_)
     {
         default: // in parent
-            close(_pty.slave()); // TODO: release slave in PTY object
+            _pty.closeSlave();
             break;
         case -1: // fork error
             throw runtime_error{ getLastErrorAsString() };
@@ -171,7 +172,11 @@ Process::~Process()
 {
 #if defined(__unix__)
     if (pid_ != -1)
+    {
+        // Hangs up a process that is still running, just like a terminal being closed does.
+        kill(pid_, SIGHUP);
         (void) wait();
+    }
 #else
     CloseHandle(processInfo_.hThread);
     CloseHandle(processInfo_.hProcess);
@@ -154,6 +154,8 @@ void PseudoTerminal::close()
         ::close(master_);
         master_ = -1;
     }
+    // Without any slave handle left open, pending reads from the master side fail.
+    closeSlave();
 #else
     if (master_ != INVALID_HANDLE_VALUE)
     {
@@ -173,6 +175,17 @@ void PseudoTerminal::close()
 #endif
 }
 
+#if defined(__unix__)
+void PseudoTerminal::closeSlave()
+{
+    if (slave_ >= 0)
+    {
+        ::close(slave_);
+        slave_ = -1;
+    }
+}
+#endif
+
 auto PseudoTerminal::read(char* buf, size_t size) -> ssize_t
 {
 #if defined(__unix__)
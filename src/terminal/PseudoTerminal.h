@@ -54,6 +54,11 @@ public:
 	/// This is automatically invoked when the destructor is called.
 	virtual void close();
 
+#if defined(__unix__)
+	/// Releases the slave side of this PTY, once the child process has been given its own handle.
+	void closeSlave();
+#endif
+
 	/// Reads from the terminal whatever has been written to from the other side of the terminal.
 	///
 	/// @param buf    Target buffer to store the received data to.
@@ -0,0 +1,105 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Recording.h>
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace terminal {
+
+namespace {
+    template <typename T>
+    void writeValue(ostream& _output, T _value)
+    {
+        _output.write(reinterpret_cast<char const*>(&_value), sizeof(_value));
+    }
+
+    template <typename T>
+    bool readValue(istream& _input, T& _value)
+    {
+        return static_cast<bool>(_input.read(reinterpret_cast<char*>(&_value), sizeof(_value)));
+    }
+}
+
+// {{{ RecordingWriter
+RecordingWriter::RecordingWriter(ostream& _output, WindowSize const& _size) :
+    file_{},
+    output_{ _output },
+    start_{ chrono::steady_clock::now() }
+{
+    output_.write(recording::Magic, sizeof(recording::Magic));
+    writeValue<uint32_t>(output_, _size.columns);
+    writeValue<uint32_t>(output_, _size.rows);
+}
+
+RecordingWriter::RecordingWriter(string const& _filePath, WindowSize const& _size) :
+    file_{ _filePath, ios::binary | ios::trunc },
+    output_{ file_ },
+    start_{ chrono::steady_clock::now() }
+{
+    if (!file_.good())
+        throw runtime_error{ "Failed to create recording file. " + _filePath };
+
+    output_.write(recording::Magic, sizeof(recording::Magic));
+    writeValue<uint32_t>(output_, _size.columns);
+    writeValue<uint32_t>(output_, _size.rows);
+}
+
+void RecordingWriter::write(char const* _data, size_t _size)
+{
+    auto const time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start_);
+    writeValue<uint64_t>(output_, static_cast<uint64_t>(time.count()));
+    writeValue<uint32_t>(output_, static_cast<uint32_t>(_size));
+    output_.write(_data, static_cast<streamsize>(_size));
+}
+// }}}
+
+// {{{ RecordingReader
+RecordingReader::RecordingReader(istream& _input) :
+    input_{ _input },
+    size_{}
+{
+    char magic[sizeof(recording::Magic)];
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+    if (!input_.read(magic, sizeof(magic))
+            || memcmp(magic, recording::Magic, sizeof(magic)) != 0
+            || !readValue(input_, columns)
+            || !readValue(input_, rows))
+        throw runtime_error{ "Input is not a session recording." };
+
+    size_ = WindowSize{columns, rows};
+}
+
+optional<recording::Chunk> RecordingReader::next()
+{
+    uint64_t time = 0;
+    if (!readValue(input_, time))
+        return nullopt;
+
+    uint32_t size = 0;
+    if (!readValue(input_, size))
+        throw runtime_error{ "Truncated session recording." };
+
+    auto chunk = recording::Chunk{chrono::nanoseconds(time), string(size, '\0')};
+    if (!input_.read(chunk.data.data(), size))
+        throw runtime_error{ "Truncated session recording." };
+
+    return {move(chunk)};
+}
+// }}}
+
+}  // namespace terminal
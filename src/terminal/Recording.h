@@ -0,0 +1,96 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/WindowSize.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace terminal {
+
+/**
+ * Session recording file format, storing raw PTY output chunks along with their timing.
+ *
+ * The file starts with a 16 byte header:
+ *   - 8 bytes magic
+ *   - uint32_t number of columns of the recorded terminal
+ *   - uint32_t number of rows of the recorded terminal
+ *
+ * followed by any number of chunks, each consisting of:
+ *   - uint64_t nanoseconds since the start of the recording
+ *   - uint32_t number of bytes
+ *   - the raw bytes, as read from the PTY
+ *
+ * All values are stored in host byte order.
+ */
+namespace recording {
+    constexpr char Magic[8] = { 'C', 'T', 'R', 'E', 'C', '\0', '\0', '\1' };
+
+    struct Chunk {
+        std::chrono::nanoseconds time; //!< time since start of recording
+        std::string data;
+    };
+}
+
+/// Records raw PTY output chunks into a session recording.
+class RecordingWriter {
+  public:
+    /// Starts a recording into the given stream, that must outlive this object.
+    RecordingWriter(std::ostream& _output, WindowSize const& _size);
+
+    /// Starts a recording into the given file.
+    ///
+    /// @throws std::runtime_error if the file cannot be created.
+    RecordingWriter(std::string const& _filePath, WindowSize const& _size);
+
+    RecordingWriter(RecordingWriter const&) = delete;
+    RecordingWriter& operator=(RecordingWriter const&) = delete;
+
+    /// Appends a chunk, timestamped with the time passed since construction.
+    void write(char const* _data, size_t _size);
+
+    void flush() { output_.flush(); }
+
+  private:
+    std::ofstream file_;
+    std::ostream& output_;
+    std::chrono::steady_clock::time_point const start_;
+};
+
+/// Reads session recordings as written by RecordingWriter.
+class RecordingReader {
+  public:
+    /// @throws std::runtime_error if the input is not a session recording.
+    explicit RecordingReader(std::istream& _input);
+
+    /// @returns the terminal size at which the session was recorded.
+    WindowSize const& size() const noexcept { return size_; }
+
+    /// @returns the next chunk or std::nullopt at the end of the recording.
+    ///
+    /// @throws std::runtime_error if the recording is truncated.
+    std::optional<recording::Chunk> next();
+
+  private:
+    std::istream& input_;
+    WindowSize size_;
+};
+
+}  // namespace terminal
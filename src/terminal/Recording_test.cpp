@@ -0,0 +1,63 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Recording.h>
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+using namespace terminal;
+using namespace std;
+
+TEST_CASE("Recording.roundtrip", "[recording]")
+{
+    auto buffer = stringstream{};
+    {
+        auto writer = RecordingWriter{buffer, WindowSize{132, 43}};
+        writer.write("\033[H\033[2J", 7);
+        writer.write("", 0);
+        writer.write("hello\0world", 11);
+    }
+
+    auto reader = RecordingReader{buffer};
+    CHECK(reader.size() == WindowSize{132, 43});
+
+    auto const a = reader.next();
+    auto const b = reader.next();
+    auto const c = reader.next();
+    REQUIRE(a.has_value());
+    REQUIRE(b.has_value());
+    REQUIRE(c.has_value());
+    CHECK_FALSE(reader.next().has_value());
+
+    CHECK(a->data == "\033[H\033[2J");
+    CHECK(b->data.empty());
+    CHECK(c->data == string("hello\0world", 11));
+    CHECK(a->time <= b->time);
+    CHECK(b->time <= c->time);
+}
+
+TEST_CASE("Recording.invalid", "[recording]")
+{
+    auto notARecording = istringstream{"definitely not a recording"};
+    CHECK_THROWS_AS(RecordingReader{notARecording}, runtime_error);
+
+    auto buffer = stringstream{};
+    {
+        auto writer = RecordingWriter{buffer, WindowSize{80, 25}};
+        writer.write("abcdef", 6);
+    }
+    auto truncated = istringstream{buffer.str().substr(0, buffer.str().size() - 2)};
+    auto reader = RecordingReader{truncated};
+    CHECK_THROWS_AS(reader.next(), runtime_error);
+}
@@ -13,6 +13,7 @@
  */
 #include <terminal/Screen.h>
 #include <terminal/OutputGenerator.h>
+#include <terminal/Tracer.h>
 #include <terminal/Util.h>
 #include <terminal/VTType.h>
 
@@ -81,12 +82,15 @@ void Screen::Buffer::resize(WindowSize const& _newSize)
         if (cursor.row == size_.rows)
         {
             auto const n = size_.rows - _newSize.rows;
-            savedLines.splice(
-                end(savedLines),
-                lines,
-                begin(lines),
-                next(begin(lines), n)
-            );
+            if (type_ == Type::Main)
+                savedLines.splice(
+                    end(savedLines),
+                    lines,
+                    begin(lines),
+                    next(begin(lines), n)
+                );
+            else
+                lines.erase(begin(lines), next(begin(lines), n));
         }
         else
             // Hard-cut below cursor by the number of lines to shrink.
@@ -306,18 +310,23 @@ void Screen::Buffer::scrollUp(cursor_pos_t v_n, Margin const& margin)
 
         if (n > 0)
         {
-            savedLines.splice(
-                end(savedLines),
-                lines,
-                begin(lines),
-                next(begin(lines), n)
-            );
+            if (type_ == Type::Main)
+                savedLines.splice(
+                    end(savedLines),
+                    lines,
+                    begin(lines),
+                    next(begin(lines), n)
+                );
+            else
+                lines.erase(begin(lines), next(begin(lines), n));
 
             generate_n(
                 back_inserter(lines),
                 n,
                 [this]() { return Line{size_.columns, Cell{{}, graphicsRendition}}; }
             );
+
+            linesScrolled += n;
         }
     }
     else
@@ -536,10 +545,11 @@ Screen::Screen(WindowSize const& _size,
     logger_{ _logger },
     useApplicationCursorKeys_{ _useApplicationCursorKeys },
     reply_{ move(reply) },
-    handler_{ _size.rows, _logger },
+    telemetry_{},
+    handler_{ _size.rows, _logger, &telemetry_ },
     parser_{ ref(handler_), _logger },
-    primaryBuffer_{ _size },
-    alternateBuffer_{ _size },
+    primaryBuffer_{ Buffer::Type::Main, _size },
+    alternateBuffer_{},
     state_{ &primaryBuffer_ },
     size_{ _size }
 {
@@ -548,29 +558,53 @@ Screen::Screen(WindowSize const& _size,
 
 void Screen::resize(WindowSize const& _newSize)
 {
-    // TODO: only resize current screen buffer, and then make sure we resize the other upon actual switch
+    // An inactive alternate buffer is resized upon switching to it.
     primaryBuffer_.resize(_newSize);
-    alternateBuffer_.resize(_newSize);
+    if (isAlternateScreen())
+        alternateBuffer_->resize(_newSize);
     size_ = _newSize;
 }
 
 void Screen::write(char const * _data, size_t _size)
 {
+    TRACE_SCOPE("Screen.write");
+
     if (logger_)
-        logger_(RawOutputEvent{ escape(_data, _data + _size) });
+        logger_(RawOutputEvent{ string(_data, _size) });
 
     handler_.commands().clear();
-    parser_.parseFragment(_data, _size);
+    {
+        TRACE_SCOPE("Screen.parse");
+        parser_.parseFragment(_data, _size);
+    }
+
+    if constexpr (Telemetry::Enabled)
+        telemetry_.countBytesParsed(_size);
+
+    auto const applyStart = Telemetry::Enabled ? chrono::steady_clock::now() : chrono::steady_clock::time_point{};
 
-    state_->verifyState();
-    for (Command const& command : handler_.commands())
     {
-        visit(*this, command);
+        TRACE_SCOPE("Screen.apply");
         state_->verifyState();
+        for (Command const& command : handler_.commands())
+        {
+            visit(*this, command);
+            state_->verifyState();
+        }
     }
 
+    if constexpr (Telemetry::Enabled)
+        telemetry_.countBatchApplied(chrono::steady_clock::now() - applyStart);
+
+    if (alternateBuffer_ && isPrimaryScreen()
+            && chrono::steady_clock::now() - primaryScreenSince_ >= alternateScreenTimeout_)
+        releaseAlternateBuffer();
+
     if (onCommands_)
+    {
+        TRACE_SCOPE("Screen.onCommands");
         onCommands_(handler_.commands());
+    }
 }
 
 void Screen::render(Renderer const& render) const
@@ -1062,9 +1096,21 @@ void Screen::operator()(SetMode const& v)
     {
         case Mode::UseAlternateScreen:
             if (v.enable)
-                state_ = &alternateBuffer_;
+            {
+                if (!alternateBuffer_)
+                {
+                    alternateBuffer_ = make_unique<Buffer>(Buffer::Type::Alternate, size_);
+                    alternateBuffer_->tabWidth = primaryBuffer_.tabWidth;
+                }
+                else if (alternateBuffer_->size() != size_)
+                    alternateBuffer_->resize(size_);
+                state_ = alternateBuffer_.get();
+            }
             else
+            {
                 state_ = &primaryBuffer_;
+                primaryScreenSince_ = chrono::steady_clock::now();
+            }
             break;
         case Mode::UseApplicationCursorKeys:
             if (useApplicationCursorKeys_)
@@ -1203,9 +1249,19 @@ void Screen::resetSoft()
 
 void Screen::resetHard()
 {
-    primaryBuffer_ = Buffer{size_};
-    alternateBuffer_ = Buffer{size_};
+    primaryBuffer_ = Buffer{Buffer::Type::Main, size_};
     state_ = &primaryBuffer_;
+    releaseAlternateBuffer();
+}
+
+void Screen::releaseAlternateBuffer()
+{
+    assert(!isAlternateScreen());
+    if (alternateBuffer_)
+    {
+        releasedLinesScrolled_ += alternateBuffer_->linesScrolled;
+        alternateBuffer_.reset();
+    }
 }
 
 Screen::Cell const& Screen::at(cursor_pos_t rowNr, cursor_pos_t colNr) const noexcept
@@ -18,13 +18,16 @@
 #include <terminal/Logger.h>
 #include <terminal/OutputHandler.h>
 #include <terminal/Parser.h>
+#include <terminal/Telemetry.h>
 #include <terminal/WindowSize.h>
 
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <list>
+#include <memory>
 #include <stack>
 #include <string>
 #include <string_view>
@@ -302,7 +305,7 @@ class Screen {
     Cell& withOriginAt(cursor_pos_t row, cursor_pos_t col) { return state_->withOriginAt(row, col); }
 
     bool isPrimaryScreen() const noexcept { return state_ == &primaryBuffer_; }
-    bool isAlternateScreen() const noexcept { return state_ == &alternateBuffer_; }
+    bool isAlternateScreen() const noexcept { return alternateBuffer_ && state_ == alternateBuffer_.get(); }
 
     bool isModeEnabled(Mode m) const noexcept
     {
@@ -361,8 +364,12 @@ class Screen {
             // TODO: Any single shift 2 (SS2) or single shift 3 (SS3) functions sent
         };
 
-        explicit Buffer(WindowSize const& _size)
-            : size_{ _size },
+        /// The alternate buffer (used by fullscreen applications) does not keep any scrollback.
+        enum class Type { Main, Alternate };
+
+        Buffer(Type _type, WindowSize const& _size)
+            : type_{ _type },
+              size_{ _size },
               margin_{
                   {1, _size.rows},
                   {1, _size.columns}
@@ -372,6 +379,7 @@ class Screen {
             verifyState();
         }
 
+        Type type_;
         WindowSize size_;
         Margin margin_;
         std::set<Mode> enabledModes_{};
@@ -384,6 +392,7 @@ class Screen {
         unsigned int tabWidth{8};
         GraphicsAttributes graphicsRendition{};
         std::stack<SavedState> savedStates{};
+        uint64_t linesScrolled{0}; // number of lines scrolled up across the full screen so far
 
         Lines::iterator currentLine{std::begin(lines)};
         Line::iterator currentColumn{std::begin(*currentLine)};
@@ -473,9 +482,20 @@ class Screen {
     {
         // TODO: Find out if we need to have that attribute per buffer or if having it across buffers is sufficient.
         primaryBuffer_.tabWidth = _value;
-        alternateBuffer_.tabWidth = _value;
+        if (alternateBuffer_)
+            alternateBuffer_->tabWidth = _value;
+    }
+
+    /// Sets the time the primary screen must have been in use before the alternate screen buffer
+    /// is released again. It is allocated anew on the next switch to the alternate screen.
+    void setAlternateScreenTimeout(std::chrono::steady_clock::duration _timeout) noexcept
+    {
+        alternateScreenTimeout_ = _timeout;
     }
 
+    /// @returns whether or not the alternate screen buffer currently occupies memory.
+    bool alternateBufferAllocated() const noexcept { return alternateBuffer_ != nullptr; }
+
     /**
      * Returns the n'th saved line into the history scrollback buffer.
      *
@@ -485,19 +505,42 @@ class Screen {
      */
     std::string renderHistoryTextLine(cursor_pos_t _lineNumberIntoHistory) const;
 
+    /// Number of lines the screen contents moved up as a whole so far, such as by linefeeds at the bottom
+    /// of the screen, across both buffers.
+    ///
+    /// Renderers may use the difference to a previous frame as a hint for moving pixels they retained,
+    /// instead of drawing the moved lines again.
+    uint64_t linesScrolled() const noexcept
+    {
+        return primaryBuffer_.linesScrolled
+             + releasedLinesScrolled_
+             + (alternateBuffer_ ? alternateBuffer_->linesScrolled : 0);
+    }
+
+    /// Parser and command statistics, safe to be read from any thread.
+    Telemetry const& telemetry() const noexcept { return telemetry_; }
+    Telemetry& telemetry() noexcept { return telemetry_; }
+
   private:
+    void releaseAlternateBuffer();
+
     Hook const onCommands_;
     Logger const logger_;
     ModeSwitchCallback useApplicationCursorKeys_;
     Reply const reply_;
 
+    Telemetry telemetry_;
     OutputHandler handler_;
     Parser parser_;
 
     Buffer primaryBuffer_;
-    Buffer alternateBuffer_;
+    std::unique_ptr<Buffer> alternateBuffer_; // allocated upon first use only
     Buffer* state_;
 
+    std::chrono::steady_clock::duration alternateScreenTimeout_ = std::chrono::seconds{30};
+    std::chrono::steady_clock::time_point primaryScreenSince_{};
+    uint64_t releasedLinesScrolled_ = 0; // linesScrolled of alternate buffers released so far
+
     WindowSize size_;
 };
 
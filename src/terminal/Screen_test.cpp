@@ -649,6 +649,83 @@ TEST_CASE("ScrollUp", "[screen]")
     }
 }
 
+TEST_CASE("LinesScrolled", "[screen]")
+{
+    Screen screen{{3, 3}, {}, {}, [&](auto const& msg) { INFO(fmt::format("{}", msg)); }, {}};
+    screen.write("ABC\r\nDEF\r\nGHI");
+    REQUIRE(0 == screen.linesScrolled());
+
+    SECTION("linefeed at bottom") {
+        screen.write("\r\nJKL\r\nMNO");
+        REQUIRE("GHI\nJKL\nMNO\n" == screen.renderText());
+        REQUIRE(2 == screen.linesScrolled());
+    }
+
+    SECTION("scroll up clamped") {
+        screen(ScrollUp{4});
+        REQUIRE(3 == screen.linesScrolled());
+    }
+
+    SECTION("inside margins") {
+        screen(SetTopBottomMargin{2, 3});
+        screen(ScrollUp{1});
+        REQUIRE("ABC\nGHI\n   \n" == screen.renderText());
+        REQUIRE(0 == screen.linesScrolled());
+    }
+}
+
+TEST_CASE("AlternateScreen", "[screen]")
+{
+    Screen screen{{3, 3}, {}, {}, [&](auto const& msg) { INFO(fmt::format("{}", msg)); }, {}};
+    screen.write("ABC\r\nDEF\r\nGHI");
+    REQUIRE_FALSE(screen.alternateBufferAllocated());
+
+    SECTION("allocated upon first use") {
+        screen(SetMode{Mode::UseAlternateScreen, true});
+        REQUIRE(screen.alternateBufferAllocated());
+        REQUIRE(screen.isAlternateScreen());
+        screen(SetMode{Mode::UseAlternateScreen, false});
+        REQUIRE("ABC\nDEF\nGHI\n" == screen.renderText());
+    }
+
+    SECTION("resized upon switch") {
+        screen(SetMode{Mode::UseAlternateScreen, true});
+        screen(SetMode{Mode::UseAlternateScreen, false});
+        screen.resize({4, 2});
+        screen(SetMode{Mode::UseAlternateScreen, true});
+        screen.write("1234\r\n5678");
+        REQUIRE("1234\n5678\n" == screen.renderText());
+    }
+
+    SECTION("no scrollback") {
+        screen(SetMode{Mode::UseAlternateScreen, true});
+        screen.write("\r\n\r\n\r\nJKL");
+        REQUIRE(0 == screen.scrollbackLines().size());
+        REQUIRE(1 == screen.linesScrolled());
+        screen(SetMode{Mode::UseAlternateScreen, false});
+        REQUIRE(0 == screen.scrollbackLines().size());
+    }
+
+    SECTION("released when idle") {
+        screen.setAlternateScreenTimeout(chrono::seconds{0});
+        screen(SetMode{Mode::UseAlternateScreen, true});
+        screen.write("\r\n\r\n\r\n");
+        screen(SetMode{Mode::UseAlternateScreen, false});
+        REQUIRE(screen.alternateBufferAllocated());
+        screen.write("\r");
+        REQUIRE_FALSE(screen.alternateBufferAllocated());
+        REQUIRE(1 == screen.linesScrolled());
+    }
+
+    SECTION("kept within timeout") {
+        screen.setAlternateScreenTimeout(chrono::hours{1});
+        screen(SetMode{Mode::UseAlternateScreen, true});
+        screen(SetMode{Mode::UseAlternateScreen, false});
+        screen.write("\r");
+        REQUIRE(screen.alternateBufferAllocated());
+    }
+}
+
 TEST_CASE("ScrollDown", "[screen]")
 {
     Screen screen{{5, 5}, {}, {}, [&](auto const& msg) { UNSCOPED_INFO(fmt::format("{}", msg)); }, {}};
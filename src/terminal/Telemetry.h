@@ -0,0 +1,196 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Commands.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <variant>
+
+namespace terminal {
+
+/**
+ * Histogram of unsigned integer samples with logarithmic (power of two) bucket sizes.
+ *
+ * Bucket 0 counts the zero samples, bucket i (i > 0) counts the samples in range [2^(i-1), 2^i).
+ * The exact minimum and maximum sample values are tracked alongside.
+ *
+ * Recording is lock-free and wait-free, using relaxed atomics,
+ * thus it may be read at any time from any thread.
+ */
+class Histogram {
+  public:
+    static constexpr size_t BucketCount = 65;
+
+    void record(uint64_t _value) noexcept
+    {
+        buckets_[bucketOf(_value)].fetch_add(1, std::memory_order_relaxed);
+
+        auto currentMin = min_.load(std::memory_order_relaxed);
+        while (_value < currentMin && !min_.compare_exchange_weak(currentMin, _value, std::memory_order_relaxed))
+            ;
+
+        auto currentMax = max_.load(std::memory_order_relaxed);
+        while (_value > currentMax && !max_.compare_exchange_weak(currentMax, _value, std::memory_order_relaxed))
+            ;
+    }
+
+    /// @returns the smallest recorded sample, or 0 if empty.
+    uint64_t min() const noexcept { return count() ? min_.load(std::memory_order_relaxed) : 0; }
+
+    /// @returns the largest recorded sample, or 0 if empty.
+    uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+    /// @returns number of samples in given bucket.
+    uint64_t bucket(size_t _index) const noexcept { return buckets_[_index].load(std::memory_order_relaxed); }
+
+    /// @returns the smallest value that fits into the given bucket.
+    static constexpr uint64_t lowerBound(size_t _index) noexcept { return _index ? uint64_t{1} << (_index - 1) : 0; }
+
+    /// @returns the largest value that fits into the given bucket.
+    static constexpr uint64_t upperBound(size_t _index) noexcept { return _index ? (lowerBound(_index) - 1) * 2 + 1 : 0; }
+
+    /// @returns the bucket index that given value is accounted to.
+    static constexpr size_t bucketOf(uint64_t _value) noexcept
+    {
+        size_t i = 0;
+        for (; _value != 0; _value >>= 1)
+            ++i;
+        return i;
+    }
+
+    /// @returns total number of recorded samples.
+    uint64_t count() const noexcept
+    {
+        uint64_t total = 0;
+        for (auto const& bucket : buckets_)
+            total += bucket.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    /// Estimates the given percentile.
+    ///
+    /// @param _percentile percentile in range [0, 100]
+    ///
+    /// @returns the upper bound of the bucket the given percentile falls into (capped by max()),
+    ///          or 0 if empty.
+    uint64_t percentile(double _percentile) const noexcept
+    {
+        auto const total = count();
+        if (!total)
+            return 0;
+
+        auto const rank = std::max(uint64_t{1}, static_cast<uint64_t>(_percentile / 100.0 * static_cast<double>(total) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; ++i)
+            if (seen += bucket(i); seen >= rank)
+                return std::min(upperBound(i), max());
+
+        return max();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& bucket : buckets_)
+            bucket.store(0, std::memory_order_relaxed);
+        min_.store(UINT64_MAX, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    std::array<std::atomic<uint64_t>, BucketCount> buckets_{};
+    std::atomic<uint64_t> min_{UINT64_MAX};
+    std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * Runtime statistics about parsing and applying VT sequences.
+ *
+ * Collecting is only performed when libterminal was built with LIBTERMINAL_TELEMETRY,
+ * otherwise all recording functions are no-ops and all counters remain zero.
+ */
+class Telemetry {
+  public:
+#if defined(LIBTERMINAL_TELEMETRY)
+    static constexpr bool Enabled = true;
+#else
+    static constexpr bool Enabled = false;
+#endif
+
+    static constexpr size_t CommandTypeCount = std::variant_size_v<Command>;
+
+    /// Accounts a single command by its index into the Command variant.
+    void countCommand(size_t _commandIndex) noexcept
+    {
+        if constexpr (Enabled)
+            commandCounts_[_commandIndex].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Accounts the number of bytes passed to the parser.
+    void countBytesParsed(size_t _count) noexcept
+    {
+        if constexpr (Enabled)
+            bytesParsed_.fetch_add(_count, std::memory_order_relaxed);
+    }
+
+    /// Accounts a batch of commands being applied to the screen, along with the time it took.
+    void countBatchApplied(std::chrono::nanoseconds _duration) noexcept
+    {
+        if constexpr (Enabled)
+        {
+            batchesApplied_.fetch_add(1, std::memory_order_relaxed);
+            applyTime_.record(static_cast<uint64_t>(_duration.count()));
+        }
+    }
+
+    /// @returns number of commands emitted with given Command variant index.
+    uint64_t commandCount(size_t _commandIndex) const noexcept
+    {
+        return commandCounts_[_commandIndex].load(std::memory_order_relaxed);
+    }
+
+    /// @returns number of commands of type T emitted.
+    template <typename T>
+    uint64_t commandCount() const noexcept
+    {
+        return commandCount(Command{T{}}.index());
+    }
+
+    uint64_t bytesParsed() const noexcept { return bytesParsed_.load(std::memory_order_relaxed); }
+    uint64_t batchesApplied() const noexcept { return batchesApplied_.load(std::memory_order_relaxed); }
+
+    /// Histogram of the time in nanoseconds it took to apply a single batch of commands.
+    Histogram const& applyTime() const noexcept { return applyTime_; }
+
+    void reset() noexcept
+    {
+        for (auto& count : commandCounts_)
+            count.store(0, std::memory_order_relaxed);
+        bytesParsed_.store(0, std::memory_order_relaxed);
+        batchesApplied_.store(0, std::memory_order_relaxed);
+        applyTime_.reset();
+    }
+
+  private:
+    std::array<std::atomic<uint64_t>, CommandTypeCount> commandCounts_{};
+    std::atomic<uint64_t> bytesParsed_{0};
+    std::atomic<uint64_t> batchesApplied_{0};
+    Histogram applyTime_;
+};
+
+}  // namespace terminal
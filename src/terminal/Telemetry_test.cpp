@@ -0,0 +1,88 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Screen.h>
+#include <terminal/Telemetry.h>
+#include <catch2/catch.hpp>
+
+using namespace terminal;
+using namespace std;
+
+TEST_CASE("Histogram.buckets", "[telemetry]")
+{
+    CHECK(Histogram::bucketOf(0) == 0);
+    CHECK(Histogram::bucketOf(1) == 1);
+    CHECK(Histogram::bucketOf(2) == 2);
+    CHECK(Histogram::bucketOf(3) == 2);
+    CHECK(Histogram::bucketOf(4) == 3);
+    CHECK(Histogram::bucketOf(UINT64_MAX) == Histogram::BucketCount - 1);
+
+    for (size_t i = 0; i < Histogram::BucketCount; ++i)
+    {
+        CHECK(Histogram::bucketOf(Histogram::lowerBound(i)) == i);
+        CHECK(Histogram::bucketOf(Histogram::upperBound(i)) == i);
+    }
+}
+
+TEST_CASE("Histogram.percentile", "[telemetry]")
+{
+    auto histogram = Histogram{};
+    CHECK(histogram.percentile(50) == 0);
+    CHECK(histogram.min() == 0);
+
+    for (int i = 0; i < 90; ++i)
+        histogram.record(100);      // bucket [64, 128)
+    for (int i = 0; i < 10; ++i)
+        histogram.record(5000);     // bucket [4096, 8192)
+
+    CHECK(histogram.count() == 100);
+    CHECK(histogram.percentile(0) == 127);
+    CHECK(histogram.percentile(50) == 127);
+    CHECK(histogram.percentile(90) == 127);
+    CHECK(histogram.percentile(99) == 5000); // capped by the largest sample
+    CHECK(histogram.percentile(100) == 5000);
+    CHECK(histogram.min() == 100);
+    CHECK(histogram.max() == 5000);
+
+    histogram.reset();
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.min() == 0);
+    CHECK(histogram.max() == 0);
+}
+
+TEST_CASE("Telemetry.Screen", "[telemetry]")
+{
+    auto screen = Screen{{10, 5}, {}, {}, {}, {}};
+    screen.write("AB\r\n\033[1;1H\033[1;1H");
+
+    Telemetry const& telemetry = screen.telemetry();
+    if constexpr (Telemetry::Enabled)
+    {
+        CHECK(telemetry.bytesParsed() == 16);
+        CHECK(telemetry.batchesApplied() == 1);
+        CHECK(telemetry.applyTime().count() == 1);
+        CHECK(telemetry.commandCount<AppendChar>() == 2);
+        CHECK(telemetry.commandCount<MoveCursorTo>() == 2);
+        CHECK(telemetry.commandCount<Linefeed>() == 1);
+        CHECK(telemetry.commandCount<Bell>() == 0);
+
+        screen.telemetry().reset();
+        CHECK(telemetry.bytesParsed() == 0);
+        CHECK(telemetry.commandCount<AppendChar>() == 0);
+    }
+    else
+    {
+        CHECK(telemetry.bytesParsed() == 0);
+        CHECK(telemetry.batchesApplied() == 0);
+    }
+}
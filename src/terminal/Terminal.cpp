@@ -14,6 +14,7 @@
 #include <terminal/Terminal.h>
 
 #include <terminal/OutputGenerator.h>
+#include <terminal/Tracer.h>
 #include <terminal/Util.h>
 
 using namespace std;
@@ -39,7 +40,12 @@ Terminal::Terminal(WindowSize _winSize, Logger _logger, Hook _onScreenCommands)
 
 Terminal::~Terminal()
 {
-    //wait();
+    // Not yet joined if the owner failed to construct before it could wait for the process.
+    if (screenUpdateThread_.joinable())
+    {
+        close();
+        wait();
+    }
 }
 
 void Terminal::useApplicationCursorKeys(bool _enable)
@@ -62,17 +68,30 @@ void Terminal::onScreenCommands(std::vector<Command> const& commands)
 
 void Terminal::screenUpdateThread()
 {
+    tracing::setThreadName("screen update");
+
     for (;;)
     {
         char buf[4096];
-        if (auto const n = read(buf, sizeof(buf)); n != -1)
+        ssize_t n = -1;
         {
-            //log("outputThread.data: {}", terminal::escape(buf, buf + n));
-            lock_guard<mutex> _l{ screenLock_ };
-            screen_.write(buf, n);
+            TRACE_SCOPE("Terminal.read");
+            n = read(buf, sizeof(buf));
         }
-        else
+
+        if (n == -1)
             break;
+
+        //log("outputThread.data: {}", terminal::escape(buf, buf + n));
+        unique_lock<mutex> _l{ screenLock_, defer_lock };
+        {
+            TRACE_SCOPE("Terminal.waitScreenLock");
+            _l.lock();
+        }
+        if (recorder_)
+            recorder_->write(buf, static_cast<size_t>(n));
+        screen_.write(buf, n);
+        inputLatency_.outputApplied();
     }
 }
 
@@ -101,8 +120,11 @@ bool Terminal::send(Key _key, Modifier _modifier)
 void Terminal::flushInput()
 {
     inputGenerator_.swap(pendingInput_);
+    if (!pendingInput_.empty())
+        inputLatency_.inputSent();
     write(pendingInput_.data(), pendingInput_.size());
-    logger_(RawInputEvent{escape(begin(pendingInput_), end(pendingInput_))});
+    if (logger_)
+        logger_(RawInputEvent{string(begin(pendingInput_), end(pendingInput_))});
     pendingInput_.clear();
 }
 
@@ -112,6 +134,12 @@ void Terminal::writeToScreen(char const* data, size_t size)
     screen_.write(data, size);
 }
 
+uint64_t Terminal::linesScrolled() const
+{
+    lock_guard<mutex> _l{ screenLock_ };
+    return screen_.linesScrolled();
+}
+
 Terminal::Cursor Terminal::cursor() const
 {
     lock_guard<mutex> _l{ screenLock_ };
@@ -126,7 +154,12 @@ string Terminal::screenshot() const
 
 void Terminal::render(Screen::Renderer const& renderer) const
 {
-    lock_guard<mutex> _l{ screenLock_ };
+    unique_lock<mutex> _l{ screenLock_, defer_lock };
+    {
+        TRACE_SCOPE("Terminal.waitScreenLock");
+        _l.lock();
+    }
+    TRACE_SCOPE("Terminal.render");
     screen_.render(renderer);
 }
 
@@ -142,9 +175,27 @@ void Terminal::wait()
     screenUpdateThread_.join();
 }
 
+void Terminal::startRecording(string const& _filePath)
+{
+    lock_guard<mutex> _l{ screenLock_ };
+    recorder_ = make_unique<RecordingWriter>(_filePath, screen_.size());
+}
+
+void Terminal::stopRecording()
+{
+    lock_guard<mutex> _l{ screenLock_ };
+    recorder_.reset();
+}
+
 void Terminal::setTabWidth(unsigned int _tabWidth)
 {
     screen_.setTabWidth(_tabWidth);
 }
 
+void Terminal::setAlternateScreenTimeout(std::chrono::steady_clock::duration _timeout)
+{
+    lock_guard<mutex> _l{ screenLock_ };
+    screen_.setAlternateScreenTimeout(_timeout);
+}
+
 }  // namespace terminal
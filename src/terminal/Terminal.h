@@ -16,12 +16,17 @@
 #include <terminal/Commands.h>
 #include <terminal/Logger.h>
 #include <terminal/InputGenerator.h>
+#include <terminal/InputLatency.h>
 #include <terminal/PseudoTerminal.h>
+#include <terminal/Recording.h>
 #include <terminal/Screen.h>
+#include <terminal/Telemetry.h>
 
 #include <fmt/format.h>
 
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string_view>
 #include <thread>
@@ -55,6 +60,9 @@ class Terminal : public PseudoTerminal {
     /// Thread-safe access to screen data for rendering
     void render(Screen::Renderer const& renderer) const;
 
+    /// @see Screen::linesScrolled()
+    uint64_t linesScrolled() const;
+
     using Cursor = Screen::Cursor; //TODO: CursorShape shape;
 
     /// @returns the current Cursor state.
@@ -70,6 +78,33 @@ class Terminal : public PseudoTerminal {
 
     void setTabWidth(unsigned int _tabWidth);
 
+    /// Sets the idle time in the primary screen after which the alternate screen buffer is released.
+    void setAlternateScreenTimeout(std::chrono::steady_clock::duration _timeout);
+
+    /// Parser and command statistics, safe to be read from any thread.
+    Telemetry const& telemetry() const noexcept { return screen_.telemetry(); }
+
+    /// Resets all telemetry counters to zero.
+    void resetTelemetry() noexcept { screen_.telemetry().reset(); }
+
+    /// Keypress-to-screen latency measurements.
+    ///
+    /// Input is stamped when sent and the first output applied thereafter closes the
+    /// input-to-applied measurement. Frontends close the input-to-frame measurement by invoking
+    /// InputLatency::framePresented() once the frame has been presented.
+    InputLatency& inputLatency() noexcept { return inputLatency_; }
+    InputLatency const& inputLatency() const noexcept { return inputLatency_; }
+
+    /// Starts recording all output read from the PTY into the given session recording file.
+    ///
+    /// @throws std::runtime_error if the file cannot be created.
+    ///
+    /// @see RecordingReader
+    void startRecording(std::string const& _filePath);
+
+    /// Stops a previously started recording, if any.
+    void stopRecording();
+
   private:
     void flushInput();
     void screenUpdateThread();
@@ -84,6 +119,8 @@ class Terminal : public PseudoTerminal {
     Screen screen_;
     Screen::Hook onScreenCommands_;
     std::mutex mutable screenLock_;
+    std::unique_ptr<RecordingWriter> recorder_; // guarded by screenLock_
+    InputLatency inputLatency_;
     std::thread screenUpdateThread_;
 };
 
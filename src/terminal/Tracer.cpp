@@ -0,0 +1,176 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Tracer.h>
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace terminal::tracing {
+
+atomic<bool> enabled_{false};
+
+namespace {
+    /// Upper bound of spans kept per thread, further spans are silently discarded.
+    constexpr size_t MaxSpansPerThread = 1'000'000;
+
+    struct Span {
+        char const* name;
+        steady_clock::time_point start;
+        steady_clock::time_point end;
+    };
+
+    struct ThreadBuffer {
+        mutex lock;
+        unsigned id;
+        string name;
+        vector<Span> spans;
+    };
+
+    struct Registry {
+        mutex lock;
+        vector<shared_ptr<ThreadBuffer>> threads;
+        unsigned nextThreadId = 1;
+        steady_clock::time_point const epoch = steady_clock::now();
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local shared_ptr<ThreadBuffer> const buffer = []() {
+            auto& r = registry();
+            auto b = make_shared<ThreadBuffer>();
+            lock_guard<mutex> _l{ r.lock };
+            b->id = r.nextThreadId++;
+            r.threads.emplace_back(b);
+            return b;
+        }();
+        return *buffer;
+    }
+
+    string escapeJson(string const& _text)
+    {
+        string result;
+        result.reserve(_text.size());
+        for (char const ch : _text)
+        {
+            if (ch == '"' || ch == '\\')
+                result += '\\';
+            if (static_cast<unsigned char>(ch) >= 0x20)
+                result += ch;
+        }
+        return result;
+    }
+}
+
+void setEnabled(bool _enabled) noexcept
+{
+    registry(); // ensures the trace epoch is taken before the first span is recorded.
+    enabled_.store(_enabled, memory_order_relaxed);
+}
+
+void setThreadName(string _name)
+{
+    auto& buffer = threadBuffer();
+    lock_guard<mutex> _l{ buffer.lock };
+    buffer.name = move(_name);
+}
+
+void Scope::record(char const* _name, steady_clock::time_point _start, steady_clock::time_point _end) noexcept
+{
+    auto& buffer = threadBuffer();
+    lock_guard<mutex> _l{ buffer.lock };
+    if (buffer.spans.size() < MaxSpansPerThread)
+    {
+        try
+        {
+            buffer.spans.emplace_back(Span{_name, _start, _end});
+        }
+        catch (...)
+        {
+            // Out of memory. Tracing must never take down the process.
+        }
+    }
+}
+
+void writeChromeTrace(ostream& _output)
+{
+    auto& r = registry();
+    lock_guard<mutex> _l{ r.lock };
+
+    auto const micros = [&](steady_clock::time_point _time) {
+        return duration<double, micro>(_time - r.epoch).count();
+    };
+
+    _output << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (auto const& thread : r.threads)
+    {
+        lock_guard<mutex> _tl{ thread->lock };
+
+        if (!thread->name.empty())
+        {
+            _output << (first ? "" : ",\n") << fmt::format(
+                "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                thread->id, escapeJson(thread->name));
+            first = false;
+        }
+
+        for (Span const& span : thread->spans)
+        {
+            _output << (first ? "" : ",\n") << fmt::format(
+                "{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                span.name, thread->id, micros(span.start), micros(span.end) - micros(span.start));
+            first = false;
+        }
+    }
+    _output << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void writeChromeTrace(string const& _filePath)
+{
+    auto output = ofstream{_filePath, ios::trunc};
+    if (!output.good())
+        throw runtime_error{ "Failed to open trace file. " + _filePath };
+
+    writeChromeTrace(output);
+
+    if (!output.good())
+        throw runtime_error{ "Failed to write trace file. " + _filePath };
+}
+
+void clear()
+{
+    auto& r = registry();
+    lock_guard<mutex> _l{ r.lock };
+    for (auto const& thread : r.threads)
+    {
+        lock_guard<mutex> _tl{ thread->lock };
+        thread->spans.clear();
+    }
+}
+
+}  // namespace terminal::tracing
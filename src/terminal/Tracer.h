@@ -0,0 +1,90 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+/**
+ * Scoped trace spans, exported in Chrome's trace event format
+ * (viewable via chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Spans are recorded into per-thread buffers, so recording never contends with other threads.
+ *
+ * When built without LIBTERMINAL_TRACING, TRACE_SCOPE() expands to nothing.
+ * Otherwise a span costs a single relaxed atomic load as long as tracing is not enabled at runtime.
+ */
+namespace terminal::tracing {
+
+extern std::atomic<bool> enabled_;
+
+/// @returns whether or not spans are currently being recorded.
+inline bool enabled() noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+/// Enables or disables recording of spans at runtime.
+void setEnabled(bool _enabled) noexcept;
+
+/// Assigns a human readable name to the calling thread, as shown in the trace viewer.
+void setThreadName(std::string _name);
+
+/// Writes all spans recorded so far as Chrome trace event JSON.
+void writeChromeTrace(std::ostream& _output);
+
+/// Writes all spans recorded so far as Chrome trace event JSON into the given file.
+///
+/// @throws std::runtime_error if the file could not be written.
+void writeChromeTrace(std::string const& _filePath);
+
+/// Discards all spans recorded so far.
+void clear();
+
+/// Records the duration of its own lifetime as a span, if tracing is enabled.
+class Scope {
+  public:
+    explicit Scope(char const* _name) noexcept :
+        name_{ enabled() ? _name : nullptr },
+        start_{ name_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} }
+    {}
+
+    ~Scope()
+    {
+        if (name_)
+            record(name_, start_, std::chrono::steady_clock::now());
+    }
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+
+  private:
+    static void record(char const* _name,
+                       std::chrono::steady_clock::time_point _start,
+                       std::chrono::steady_clock::time_point _end) noexcept;
+
+    char const* const name_;
+    std::chrono::steady_clock::time_point const start_;
+};
+
+}  // namespace terminal::tracing
+
+#define TERMINAL_TRACE_CONCAT_(a, b) a##b
+#define TERMINAL_TRACE_CONCAT(a, b) TERMINAL_TRACE_CONCAT_(a, b)
+
+#if defined(LIBTERMINAL_TRACING)
+/// Traces the remainder of the current scope as a span of given (string literal) name.
+#define TRACE_SCOPE(name) ::terminal::tracing::Scope TERMINAL_TRACE_CONCAT(_traceScope, __LINE__){ name }
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#endif
@@ -0,0 +1,75 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Tracer.h>
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <thread>
+
+using namespace terminal;
+using namespace std;
+
+namespace {
+    size_t countOccurrences(string const& _text, string const& _pattern)
+    {
+        size_t count = 0;
+        for (auto i = _text.find(_pattern); i != string::npos; i = _text.find(_pattern, i + 1))
+            ++count;
+        return count;
+    }
+}
+
+TEST_CASE("Tracer.disabled", "[tracer]")
+{
+    tracing::clear();
+    tracing::setEnabled(false);
+    {
+        tracing::Scope scope{"disabled.span"};
+    }
+
+    auto output = ostringstream{};
+    tracing::writeChromeTrace(output);
+    CHECK(output.str().find("disabled.span") == string::npos);
+}
+
+TEST_CASE("Tracer.chrome_trace", "[tracer]")
+{
+    tracing::clear();
+    tracing::setEnabled(true);
+    {
+        tracing::Scope outer{"outer.span"};
+        tracing::Scope inner{"inner.span"};
+    }
+    auto worker = thread{[]() {
+        tracing::setThreadName("worker \"1\"");
+        tracing::Scope scope{"worker.span"};
+    }};
+    worker.join();
+    tracing::setEnabled(false);
+
+    auto output = ostringstream{};
+    tracing::writeChromeTrace(output);
+    auto const json = output.str();
+
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(countOccurrences(json, "\"name\":\"outer.span\",\"ph\":\"X\"") == 1);
+    CHECK(countOccurrences(json, "\"name\":\"inner.span\",\"ph\":\"X\"") == 1);
+    CHECK(countOccurrences(json, "\"name\":\"worker.span\",\"ph\":\"X\"") == 1);
+    CHECK(countOccurrences(json, "\"args\":{\"name\":\"worker \\\"1\\\"\"}") == 1);
+
+    tracing::clear();
+    output = ostringstream{};
+    tracing::writeChromeTrace(output);
+    CHECK(output.str().find("outer.span") == string::npos);
+}
@@ -60,11 +60,10 @@ inline std::string escape(char32_t ch)
 template <typename T>
 inline std::string escape(T begin, T end)
 {
-    return std::accumulate(begin, end, std::string{}, [](auto const& a, auto ch) { return a + escape(ch); });
-    // auto result = std::string{};
-    // for (T cur = begin; cur != end; ++cur)
-    //     result += *cur;
-    // return result;
+    auto result = std::string{};
+    for (T cur = begin; cur != end; ++cur)
+        result += escape(*cur);
+    return result;
 }
 
 inline std::string escape(std::string const& s)
@@ -0,0 +1,431 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/BinaryLog.h>
+#include <terminal/OutputGenerator.h>
+#include <terminal/OutputHandler.h>
+#include <terminal/Parser.h>
+#include <terminal/Screen.h>
+#include <terminal/UTF8.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+/*
+ * Headless throughput benchmarks of the VT processing pipeline,
+ * driving Parser, OutputHandler, Screen and OutputGenerator directly, without any PTY or GL.
+ *
+ * The screen is also measured with logging enabled, once logging as text and once into a binary log
+ * (logging.format: binary), including flushing the log at the end. Either with RawOutput logging
+ * only, or with TraceOutput logging as well.
+ *
+ * Usage: terminal_bench [MEGABYTES_PER_WORKLOAD] [WORKLOAD_FILTER]
+ *
+ * Results are written to stdout as JSON.
+ */
+
+using namespace std;
+using namespace terminal;
+
+// {{{ allocation counting
+namespace {
+    atomic<uint64_t> allocationCount{0};
+}
+
+void* operator new(size_t _size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(_size ? _size : 1); p)
+        return p;
+    throw bad_alloc{};
+}
+
+void* operator new[](size_t _size)
+{
+    return operator new(_size);
+}
+
+void operator delete(void* _p) noexcept
+{
+    free(_p);
+}
+
+void operator delete[](void* _p) noexcept
+{
+    free(_p);
+}
+
+void operator delete(void* _p, size_t) noexcept
+{
+    free(_p);
+}
+
+void operator delete[](void* _p, size_t) noexcept
+{
+    free(_p);
+}
+// }}}
+
+namespace {
+
+constexpr auto PageSize = WindowSize{120, 40};
+constexpr size_t ChunkSize = 4096; // same read size as Terminal's screen update thread
+
+/// @returns peak resident set size in KiB, or 0 if unknown.
+uint64_t peakResidentSetSize()
+{
+#if defined(__unix__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return static_cast<uint64_t>(usage.ru_maxrss); // KiB on Linux
+#elif defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return static_cast<uint64_t>(usage.ru_maxrss) / 1024; // bytes on macOS
+#endif
+    return 0;
+}
+
+// {{{ workloads
+/// Repeats @p _generateOnce until at least @p _size bytes have been generated.
+string repeatUntil(size_t _size, function<void(string&, size_t)> const& _generateOnce)
+{
+    string output;
+    output.reserve(_size + 64 * 1024);
+    for (size_t i = 0; output.size() < _size; ++i)
+        _generateOnce(output, i);
+    return output;
+}
+
+string ascii(size_t _size)
+{
+    string_view constexpr alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ "
+        "abcdefghijklmnopqrstuvwxyz "
+        "0123456789 []{}();+-*/=";
+
+    return repeatUntil(_size, [&](string& out, size_t i) {
+        for (cursor_pos_t col = 0; col < PageSize.columns; ++col)
+            out += alphabet[(i + col) % alphabet.size()];
+        out += "\r\n";
+    });
+}
+
+string cjk(size_t _size)
+{
+    return repeatUntil(_size, [&](string& out, size_t i) {
+        for (cursor_pos_t col = 0; col < PageSize.columns / 2; ++col)
+        {
+            auto const bytes = utf8::encode(static_cast<char32_t>(0x4E00 + (i * 61 + col) % 0x5000));
+            out.append(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+        }
+        out += "\r\n";
+    });
+}
+
+string sgr(size_t _size)
+{
+    return repeatUntil(_size, [&](string& out, size_t i) {
+        for (cursor_pos_t col = 0; col < PageSize.columns; ++col)
+        {
+            auto const k = i * PageSize.columns + col;
+            out += fmt::format("\033[38;2;{};{};{}m\033[48;2;{};{};{}m",
+                               k % 256, (k * 3) % 256, (k * 7) % 256,
+                               (k * 11) % 256, (k * 13) % 256, (k * 17) % 256);
+            if (k % 8 == 0)
+                out += "\033[1;4m";
+            out += static_cast<char>('A' + k % 26);
+            if (k % 8 == 7)
+                out += "\033[m";
+        }
+        out += "\033[m\r\n";
+    });
+}
+
+string tui(size_t _size)
+{
+    // Full-screen redraws as typically done by curses-like applications:
+    // cursor addressing, partial line updates, erasures and a status line.
+    return repeatUntil(_size, [&](string& out, size_t frame) {
+        for (cursor_pos_t row = 1; row < PageSize.rows; ++row)
+        {
+            out += fmt::format("\033[{};1H", row);
+            out += (row + frame) % 2 ? "\033[34m" : "\033[32m";
+            out += fmt::format("{:>4} ", row + frame);
+            out += "\033[m";
+            for (cursor_pos_t col = 6; col < PageSize.columns / 2; ++col)
+                out += static_cast<char>('a' + (row + col + frame) % 26);
+            out += "\033[K";
+        }
+        out += fmt::format("\033[{};1H\033[7m -- frame {} -- \033[m\033[K", PageSize.rows, frame);
+        out += fmt::format("\033[{};{}H", 1 + frame % (PageSize.rows - 1), 1 + frame % PageSize.columns);
+    });
+}
+
+string scrollRegions(size_t _size)
+{
+    // Vertical (DECSTBM) and horizontal (DECSLRM) margins, with lines scrolling inside of them.
+    return repeatUntil(_size, [&](string& out, size_t i) {
+        auto const top = 2 + i % 5;
+        auto const bottom = PageSize.rows - 2 - i % 7;
+        auto const left = 5 + i % 11;
+        auto const right = PageSize.columns - 5 - i % 13;
+
+        out += "\033[?69h";
+        out += fmt::format("\033[{};{}r", top, bottom);
+        out += fmt::format("\033[{};{}s", left, right);
+        out += fmt::format("\033[{};{}H", bottom, left);
+        for (size_t line = 0; line < 20; ++line)
+        {
+            for (size_t col = left; col <= right; ++col)
+                out += static_cast<char>('0' + (line + col) % 10);
+            out += "\n";
+            out += fmt::format("\033[{}G", left);
+        }
+        out += "\033[?69l\033[r";
+    });
+}
+
+string alternateScreen(size_t _size)
+{
+    // Repeatedly entering and leaving the alternate screen, as pagers and editors do.
+    return repeatUntil(_size, [&](string& out, size_t i) {
+        out += "\033[?1049h\033[H\033[2J";
+        for (cursor_pos_t row = 1; row <= 5; ++row)
+            out += fmt::format("\033[{};1Hpage {} line {}", row, i, row);
+        out += "\033[?1049l";
+        out += fmt::format("shell prompt {} $ \r\n", i);
+    });
+}
+
+struct Workload {
+    string_view name;
+    string (*generate)(size_t);
+};
+
+auto constexpr workloads = array{
+    Workload{"ascii", &ascii},
+    Workload{"cjk", &cjk},
+    Workload{"sgr_truecolor", &sgr},
+    Workload{"tui_redraw", &tui},
+    Workload{"scroll_regions", &scrollRegions},
+    Workload{"alternate_screen", &alternateScreen},
+};
+// }}}
+
+// {{{ stages
+struct Result {
+    uint64_t bytes;
+    chrono::nanoseconds duration;
+    uint64_t allocations;
+    uint64_t dropped = 0; // log events dropped
+};
+
+template <typename Run>
+Result measure(uint64_t _bytes, Run const& _run)
+{
+    auto const allocationsBefore = allocationCount.load(memory_order_relaxed);
+    auto const start = chrono::steady_clock::now();
+    _run();
+    auto const duration = chrono::steady_clock::now() - start;
+    auto const allocations = allocationCount.load(memory_order_relaxed) - allocationsBefore;
+    return Result{_bytes, chrono::duration_cast<chrono::nanoseconds>(duration), allocations, 0};
+}
+
+template <typename Sink>
+void forEachChunk(string const& _input, Sink const& _sink)
+{
+    for (size_t offset = 0; offset < _input.size(); offset += ChunkSize)
+        _sink(_input.data() + offset, min(ChunkSize, _input.size() - offset));
+}
+
+/// Parser and OutputHandler only, producing commands.
+Result benchParser(string const& _input)
+{
+    auto handler = OutputHandler{PageSize.rows, {}};
+    auto parser = Parser{ref(handler)};
+    return measure(_input.size(), [&]() {
+        forEachChunk(_input, [&](char const* _data, size_t _size) {
+            handler.commands().clear();
+            parser.parseFragment(_data, _size);
+        });
+    });
+}
+
+/// The full Screen::write() path: parsing and applying commands.
+Result benchScreen(string const& _input)
+{
+    auto screen = Screen{PageSize, {}, {}, {}, {}};
+    return measure(_input.size(), [&]() {
+        forEachChunk(_input, [&](char const* _data, size_t _size) {
+            screen.write(_data, _size);
+        });
+    });
+}
+
+/// Screen::write() with logging enabled, the way the GL frontend logs: each chunk's raw output,
+/// followed by a trace of the applied commands if @p _trace is set.
+Result benchLoggedScreen(string const& _input, Logger const& _logger, Screen::Hook const& _trace,
+                         function<void()> const& _flush)
+{
+    auto screen = Screen{PageSize, {}, {}, _logger, _trace};
+    return measure(_input.size(), [&]() {
+        forEachChunk(_input, [&](char const* _data, size_t _size) {
+            screen.write(_data, _size);
+        });
+        _flush();
+    });
+}
+
+string tempLogFile(string_view _name)
+{
+    return (filesystem::temp_directory_path() / fmt::format("terminal_bench-{}.log", _name)).string();
+}
+
+template <bool Trace>
+Result benchTextLog(string const& _input)
+{
+    auto const filePath = tempLogFile("text");
+    auto result = [&]() {
+        auto sink = ofstream{filePath, ios::trunc};
+        auto const log = [&](LogEvent const& _event) { sink << fmt::format("{}\n", _event); };
+        auto const trace = [&](vector<Command> const& _commands) {
+            log(TraceOutputEvent{ fmt::format("onScreenUpdate: {} instructions", _commands.size()) });
+            for (auto const& mnemonic : to_mnemonic(_commands, true, true))
+                log(TraceOutputEvent{ mnemonic });
+        };
+        return benchLoggedScreen(_input, log, Trace ? Screen::Hook{trace} : Screen::Hook{}, [&]() { sink.flush(); });
+    }();
+    remove(filePath.c_str());
+    return result;
+}
+
+template <bool Trace>
+Result benchBinaryLog(string const& _input)
+{
+    auto const filePath = tempLogFile("binary");
+    auto result = [&]() {
+        auto writer = BinaryLogWriter{filePath};
+        // The commands are traced as they are, leaving their formatting to binlog_decode.
+        auto const trace = [&](vector<Command> const& _commands) { writer.write(_commands); };
+        auto logged = benchLoggedScreen(_input,
+                                        [&](LogEvent const& _event) { writer.write(_event); },
+                                        Trace ? Screen::Hook{trace} : Screen::Hook{},
+                                        [&]() { writer.flush(); });
+        logged.dropped = writer.droppedCount();
+        return logged;
+    }();
+    remove(filePath.c_str());
+    return result;
+}
+
+/// Re-generating VT sequences from previously parsed commands.
+Result benchGenerator(string const& _input)
+{
+    auto batches = vector<vector<Command>>{};
+    {
+        auto handler = OutputHandler{PageSize.rows, {}};
+        auto parser = Parser{ref(handler)};
+        forEachChunk(_input, [&](char const* _data, size_t _size) {
+            handler.commands().clear();
+            parser.parseFragment(_data, _size);
+            batches.emplace_back(handler.commands());
+        });
+    }
+
+    uint64_t bytesGenerated = 0;
+    auto result = measure(0, [&]() {
+        auto generator = OutputGenerator{[&](char const*, size_t _size) { bytesGenerated += _size; }};
+        for (auto const& batch : batches)
+            generator(batch);
+        generator.flush();
+    });
+    result.bytes = bytesGenerated;
+    return result;
+}
+
+struct Stage {
+    string_view name;
+    Result (*run)(string const&);
+};
+
+auto constexpr stages = array{
+    Stage{"parser", &benchParser},
+    Stage{"screen", &benchScreen},
+    Stage{"screen_text_log_raw", &benchTextLog<false>},
+    Stage{"screen_binary_log_raw", &benchBinaryLog<false>},
+    Stage{"screen_text_log_trace", &benchTextLog<true>},
+    Stage{"screen_binary_log_trace", &benchBinaryLog<true>},
+    Stage{"generator", &benchGenerator},
+};
+// }}}
+
+string toJson(string_view _workload, string_view _stage, Result const& _result)
+{
+    auto const seconds = chrono::duration<double>(_result.duration).count();
+    auto const megabytes = static_cast<double>(_result.bytes) / (1024.0 * 1024.0);
+    return fmt::format(
+        "{{\"workload\": \"{}\", \"stage\": \"{}\", \"bytes\": {}, \"seconds\": {:.6f}, "
+        "\"mbPerSecond\": {:.2f}, \"nsPerByte\": {:.3f}, \"allocationsPerMB\": {:.1f}, "
+        "\"droppedLogEvents\": {}, \"peakRssKiB\": {}}}",
+        _workload, _stage, _result.bytes, seconds,
+        seconds > 0 ? megabytes / seconds : 0.0,
+        _result.bytes ? static_cast<double>(_result.duration.count()) / static_cast<double>(_result.bytes) : 0.0,
+        megabytes > 0 ? static_cast<double>(_result.allocations) / megabytes : 0.0,
+        _result.dropped,
+        peakResidentSetSize());
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    size_t const megabytes = argc > 1 ? static_cast<size_t>(stoul(argv[1])) : 8;
+    string_view const filter = argc > 2 ? argv[2] : "";
+
+    cout << "{\n  \"benchmarks\": [";
+    bool first = true;
+    for (Workload const& workload : workloads)
+    {
+        if (!filter.empty() && workload.name.find(filter) == string_view::npos)
+            continue;
+
+        auto const input = workload.generate(megabytes * 1024 * 1024);
+        for (Stage const& stage : stages)
+        {
+            auto const result = stage.run(input);
+            cout << (first ? "\n    " : ",\n    ") << toJson(workload.name, stage.name, result);
+            cout.flush();
+            first = false;
+        }
+    }
+    cout << fmt::format("\n  ],\n  \"peakRssKiB\": {}\n}}\n", peakResidentSetSize());
+
+    return EXIT_SUCCESS;
+}
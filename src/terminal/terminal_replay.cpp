@@ -0,0 +1,206 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Process.h>
+#include <terminal/Recording.h>
+#include <terminal/Screen.h>
+#include <terminal/Telemetry.h>
+#include <terminal/Terminal.h>
+#include <terminal/Util.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Records PTY sessions and deterministically replays them into a headless Screen.
+ *
+ * Usage:
+ *   terminal_replay record [--size COLUMNSxROWS] OUTPUT COMMAND [ARGS...]
+ *   terminal_replay [--realtime] [--expect HASH] INPUT
+ *
+ * Replaying reports throughput, per-chunk apply latency and a hash of the final screen text
+ * as JSON. With --expect, the exit code reflects whether or not the hash matches,
+ * which makes recordings usable as regression tests.
+ */
+
+using namespace std;
+using namespace terminal;
+
+namespace {
+
+/// 64-bit FNV-1a hash, stable across platforms and runs.
+uint64_t fnv1a(string_view _text)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char const ch : _text)
+    {
+        hash ^= static_cast<uint8_t>(ch);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+int usage(char const* _program)
+{
+    cerr << "Usage:\n"
+         << "  " << _program << " record [--size COLUMNSxROWS] OUTPUT COMMAND [ARGS...]\n"
+         << "  " << _program << " [--realtime] [--expect HASH] INPUT\n";
+    return EXIT_FAILURE;
+}
+
+int record(vector<string_view> _args, char const* _program)
+{
+    auto size = WindowSize{80, 25};
+    if (_args.size() >= 2 && _args[0] == "--size")
+    {
+        auto const spec = string(_args[1]);
+        auto const x = spec.find('x');
+        if (x == string::npos)
+            return usage(_program);
+        size = WindowSize{
+            static_cast<unsigned>(stoul(spec.substr(0, x))),
+            static_cast<unsigned>(stoul(spec.substr(x + 1)))
+        };
+        _args.erase(_args.begin(), _args.begin() + 2);
+    }
+
+    if (_args.size() < 2)
+        return usage(_program);
+
+    auto const outputFile = string(_args[0]);
+    auto const command = vector<string>(next(_args.begin()), _args.end());
+
+    auto terminal = Terminal{size};
+    terminal.startRecording(outputFile);
+
+    auto process = Process{terminal, command[0], command, {{"TERM", "xterm-256color"}}};
+    for (;;)
+        if (visit(overloaded{[&](Process::NormalExit) { return true; },
+                             [&](Process::SignalExit) { return true; },
+                             [&](Process::Suspend) { return false; },
+                             [&](Process::Resume) { return false; },
+                  },
+                  process.wait()))
+            break;
+
+    // The screen update thread terminates once all output has been read.
+    terminal.wait();
+    terminal.stopRecording();
+
+    return EXIT_SUCCESS;
+}
+
+int replay(vector<string_view> _args, char const* _program)
+{
+    bool realtime = false;
+    optional<string> expectedHash;
+    while (_args.size() > 1)
+    {
+        if (_args[0] == "--realtime")
+        {
+            realtime = true;
+            _args.erase(_args.begin());
+        }
+        else if (_args[0] == "--expect" && _args.size() > 2)
+        {
+            expectedHash = string(_args[1]);
+            _args.erase(_args.begin(), _args.begin() + 2);
+        }
+        else
+            return usage(_program);
+    }
+
+    if (_args.size() != 1)
+        return usage(_program);
+
+    auto input = ifstream{string(_args[0]), ios::binary};
+    if (!input.good())
+    {
+        cerr << "Could not open file. " << _args[0] << endl;
+        return EXIT_FAILURE;
+    }
+
+    auto reader = RecordingReader{input};
+    auto screen = Screen{reader.size(), {}, {}, {}, {}};
+
+    auto latency = Histogram{};
+    auto busy = chrono::nanoseconds::zero();
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+
+    auto const start = chrono::steady_clock::now();
+    while (auto const chunk = reader.next())
+    {
+        if (realtime)
+            this_thread::sleep_until(start + chunk->time);
+
+        auto const applyStart = chrono::steady_clock::now();
+        screen.write(chunk->data.data(), chunk->data.size());
+        auto const duration = chrono::steady_clock::now() - applyStart;
+
+        latency.record(static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(duration).count()));
+        busy += duration;
+        bytes += chunk->data.size();
+        ++chunks;
+    }
+    auto const elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    auto const busySeconds = chrono::duration<double>(busy).count();
+    auto const hash = fmt::format("{:016x}", fnv1a(screen.renderText()));
+
+    cout << fmt::format(
+        "{{\"bytes\": {}, \"chunks\": {}, \"seconds\": {:.6f}, \"busySeconds\": {:.6f}, "
+        "\"mbPerSecond\": {:.2f}, "
+        "\"applyLatencyNs\": {{\"min\": {}, \"p50\": {}, \"p99\": {}, \"max\": {}}}, "
+        "\"screenHash\": \"{}\"}}\n",
+        bytes, chunks, elapsed, busySeconds,
+        busySeconds > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / busySeconds : 0.0,
+        latency.min(), latency.percentile(50), latency.percentile(99), latency.max(),
+        hash);
+
+    if (expectedHash && *expectedHash != hash)
+    {
+        cerr << fmt::format("Screen hash mismatch. Expected {} but got {}.\n", *expectedHash, hash);
+        cerr << screen.renderText();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    auto args = vector<string_view>(argv + 1, argv + argc);
+    try
+    {
+        if (!args.empty() && args[0] == "record")
+            return record(vector<string_view>(next(args.begin()), args.end()), argv[0]);
+        else
+            return replay(move(args), argv[0]);
+    }
+    catch (exception const& e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}